@@ -0,0 +1,370 @@
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <bit>
+#include "../../src/dot_engine/engine.hpp"
+#include "../../src/dot_engine/components/body/dynamic_rigid_body.hpp"
+#include "../../src/dot_engine/components/universal_law/gravity.hpp"
+#include "../../src/dot_engine/components/force/link.hpp"
+#include "../../src/dot_engine/components/force/implicit_spring_network.hpp"
+#include "../../src/dot_engine/components/collision_effect/blocking.hpp"
+#include "../../src/dot_engine/components/constraint/xpbd_solver.hpp"
+#include "../../src/dot_engine/components/force/jump.hpp"
+
+// Scenes sans affichage qui comparent les solveurs au chemin explicite
+// usage: benchmark spring_chain | xpbd | bullet | system_graph
+
+struct BenchmarkResult
+{
+    double time_per_tick_ms;
+    bool is_stable;
+};
+
+// -ffast-math retire les tests de nan, l'exposant est lu directement
+bool is_finite(const float value)
+{
+    return ((std::bit_cast<uint32_t>(value) >> 23) & 0xFF) != 0xFF;
+}
+
+// Chaine de 20 masses accrochee a un point fixe sous la gravite, ressorts explicites ou reseau implicite
+BenchmarkResult run_spring_chain(const bool is_implicit, const size_t high_resolution_multiplier, const float hardness, float& max_strain, Float2d& tip_position)
+{
+    const size_t nbr_mass = 20;
+    const size_t nbr_tick = 500;
+    const float dt_second = 0.01;
+    const float link_length = 10.0;
+
+    DotEngine engine;
+    engine.register_system_low_resolution(std::make_shared<DotUniversalLawGravity>(Float2d(0.0, -100.0)));
+
+    std::shared_ptr<DotStaticRigidBody> anchor_ptr = std::make_shared<DotStaticRigidBody>();
+    anchor_ptr->set_mass(1.0);
+    engine.register_body(anchor_ptr);
+
+    std::shared_ptr<DotImplicitSpringNetwork> network_ptr = std::make_shared<DotImplicitSpringNetwork>();
+    std::vector<std::shared_ptr<DotDynamicRigidBody>> mass_ptrs;
+    std::shared_ptr<DotStaticRigidBody> previous_ptr = anchor_ptr;
+    for(size_t i = 0; i < nbr_mass; i++)
+    {
+        std::shared_ptr<DotDynamicRigidBody> mass_ptr = std::make_shared<DotDynamicRigidBody>();
+        mass_ptr->set_mass(1.0);
+        mass_ptr->set_size(0.0);
+        mass_ptr->set_weak_collision(true);
+        mass_ptr->set_position(Float2d((i + 1) * link_length, 0.0));
+        engine.register_body(mass_ptr);
+
+        std::shared_ptr<DotSpringLink> link_ptr = std::make_shared<DotSpringLink>();
+        link_ptr->set_target_a(previous_ptr);
+        link_ptr->set_target_b(mass_ptr);
+        link_ptr->set_length(link_length);
+        link_ptr->set_hardness(hardness);
+        link_ptr->set_damping(1.0);
+        if( is_implicit ) network_ptr->add_link(link_ptr);
+        else engine.register_system_high_resolution(link_ptr);
+
+        mass_ptrs.push_back(mass_ptr);
+        previous_ptr = mass_ptr;
+    }
+    if( is_implicit ) engine.register_system_low_resolution(network_ptr);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nbr_tick; i++) engine.update(dt_second, high_resolution_multiplier);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    BenchmarkResult result;
+    result.time_per_tick_ms = std::chrono::duration<double, std::milli>(end - start).count() / nbr_tick;
+    result.is_stable = true;
+    max_strain = 0.0;
+    Float2d previous_position = anchor_ptr->get_position();
+    for(const std::shared_ptr<DotDynamicRigidBody>& mass_ptr : mass_ptrs)
+    {
+        const float length = (mass_ptr->get_position() - previous_position).norm();
+        if( !is_finite(length) )
+        {
+            result.is_stable = false;
+            continue;
+        }
+        max_strain = std::max(max_strain, std::abs(length - link_length) / link_length);
+        previous_position = mass_ptr->get_position();
+    }
+    // Une chaine etiree de plus de 10 fois sa longueur a diverge
+    if( max_strain > 10.0 ) result.is_stable = false;
+    tip_position = mass_ptrs.back()->get_position();
+    return result;
+}
+
+void benchmark_spring_chain()
+{
+    std::printf("Spring chain, 20 masses, dt 0.01 s, 500 ticks\n");
+    for(const float hardness : {1e4f, 1e5f, 1e6f})
+    {
+        for(const size_t high_resolution_multiplier : {1, 5, 10, 20, 50, 100})
+        {
+            float max_strain = 0.0;
+            Float2d tip_position;
+            const BenchmarkResult result = run_spring_chain(false, high_resolution_multiplier, hardness, max_strain, tip_position);
+            std::printf("  k %.0e explicit x%-3zu %-8s %.3f ms/tick max strain %.4f tip (%.1f, %.1f)\n", hardness, high_resolution_multiplier, result.is_stable ? "stable" : "unstable", result.time_per_tick_ms, max_strain, tip_position.x(), tip_position.y());
+        }
+        float max_strain = 0.0;
+        Float2d tip_position;
+        const BenchmarkResult result = run_spring_chain(true, 1, hardness, max_strain, tip_position);
+        std::printf("  k %.0e implicit x1   %-8s %.3f ms/tick max strain %.4f tip (%.1f, %.1f)\n", hardness, result.is_stable ? "stable" : "unstable", result.time_per_tick_ms, max_strain, tip_position.x(), tip_position.y());
+    }
+}
+
+// 200 boules posees sur un sol et une corde de 20 maillons, forces de penalite ou solveur XPBD
+BenchmarkResult run_xpbd(const bool is_xpbd, const size_t high_resolution_multiplier, const size_t iteration_nbr, float& max_penetration, float& max_rope_stretch)
+{
+    const size_t nbr_tick = 300;
+    const float dt_second = 0.01;
+    const float hardness = 50000.0;
+    const float ball_size = 5.0;
+    const float link_length = 10.0;
+
+    DotEngine engine;
+
+    // Les systemes basse resolution sont appliques du dernier enregistre au premier, le solveur passe apres la gravite
+    std::shared_ptr<DotXpbdSolver> solver_ptr = std::make_shared<DotXpbdSolver>();
+    solver_ptr->set_iteration_nbr(iteration_nbr);
+    if( is_xpbd ) engine.register_system_low_resolution(solver_ptr);
+    else engine.register_system_high_resolution(std::make_shared<DotBlockingCollisionEffect>());
+    engine.register_system_low_resolution(std::make_shared<DotUniversalLawGravity>(Float2d(0.0, -100.0)));
+
+    std::shared_ptr<DotStaticRigidBody> ground_ptr = std::make_shared<DotStaticRigidBody>();
+    ground_ptr->set_hardness(hardness);
+    ground_ptr->set_damping(500.0);
+    ground_ptr->set_mass(1000000.0);
+    ground_ptr->set_size(100000.0);
+    ground_ptr->set_position(Float2d(0.0, -100000.0));
+    engine.register_body(ground_ptr);
+
+    std::vector<std::shared_ptr<DotDynamicRigidBody>> ball_ptrs;
+    for(size_t i = 0; i < 20; i++)
+    {
+        for(size_t j = 0; j < 10; j++)
+        {
+            std::shared_ptr<DotDynamicRigidBody> ball_ptr = std::make_shared<DotDynamicRigidBody>();
+            ball_ptr->set_hardness(hardness);
+            ball_ptr->set_damping(50.0);
+            ball_ptr->set_mass(1.0);
+            ball_ptr->set_size(ball_size);
+            ball_ptr->set_position(Float2d(i * 10.5f, ball_size + (j * 10.5f)));
+            engine.register_body(ball_ptr);
+            ball_ptrs.push_back(ball_ptr);
+        }
+    }
+
+    // Corde accrochee a un point fixe, rigide pour le solveur
+    std::shared_ptr<DotStaticRigidBody> anchor_ptr = std::make_shared<DotStaticRigidBody>();
+    anchor_ptr->set_mass(1.0);
+    anchor_ptr->set_position(Float2d(-300.0, 300.0));
+    engine.register_body(anchor_ptr);
+
+    std::vector<std::shared_ptr<DotDynamicRigidBody>> rope_mass_ptrs;
+    std::shared_ptr<DotStaticRigidBody> previous_ptr = anchor_ptr;
+    for(size_t i = 0; i < 20; i++)
+    {
+        std::shared_ptr<DotDynamicRigidBody> mass_ptr = std::make_shared<DotDynamicRigidBody>();
+        mass_ptr->set_mass(1.0);
+        mass_ptr->set_size(0.0);
+        mass_ptr->set_weak_collision(true);
+        mass_ptr->set_position(Float2d(-300.0 + ((i + 1) * link_length), 300.0));
+        engine.register_body(mass_ptr);
+
+        std::shared_ptr<DotRopeLink> rope_ptr = std::make_shared<DotRopeLink>();
+        rope_ptr->set_target_a(previous_ptr);
+        rope_ptr->set_target_b(mass_ptr);
+        rope_ptr->set_length(link_length);
+        rope_ptr->set_hardness(is_xpbd ? 0.0 : 100000.0);
+        rope_ptr->set_damping(10.0);
+        if( is_xpbd ) solver_ptr->add_rope(rope_ptr);
+        else engine.register_system_high_resolution(rope_ptr);
+
+        rope_mass_ptrs.push_back(mass_ptr);
+        previous_ptr = mass_ptr;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nbr_tick; i++) engine.update(dt_second, high_resolution_multiplier);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    BenchmarkResult result;
+    result.time_per_tick_ms = std::chrono::duration<double, std::milli>(end - start).count() / nbr_tick;
+    result.is_stable = true;
+    max_penetration = 0.0;
+    for(const std::shared_ptr<DotDynamicRigidBody>& ball_ptr : ball_ptrs)
+    {
+        const Float2d position = ball_ptr->get_position();
+        if( !is_finite(position.x()) || !is_finite(position.y()) )
+        {
+            result.is_stable = false;
+            continue;
+        }
+        max_penetration = std::max(max_penetration, ball_size - position.y());
+        for(const std::shared_ptr<DotDynamicRigidBody>& other_ptr : ball_ptrs)
+        {
+            if( other_ptr == ball_ptr ) continue;
+            const float dist = (other_ptr->get_position() - position).norm();
+            if( is_finite(dist) ) max_penetration = std::max(max_penetration, (2 * ball_size) - dist);
+        }
+    }
+    max_rope_stretch = 0.0;
+    Float2d previous_position = anchor_ptr->get_position();
+    for(const std::shared_ptr<DotDynamicRigidBody>& mass_ptr : rope_mass_ptrs)
+    {
+        const float length = (mass_ptr->get_position() - previous_position).norm();
+        if( !is_finite(length) )
+        {
+            result.is_stable = false;
+            continue;
+        }
+        max_rope_stretch = std::max(max_rope_stretch, (length - link_length) / link_length);
+        previous_position = mass_ptr->get_position();
+    }
+    return result;
+}
+
+void benchmark_xpbd()
+{
+    std::printf("XPBD, 200 balls on the ground and a 20 link rope, hardness 5e4, dt 0.01 s, 300 ticks\n");
+    for(const size_t high_resolution_multiplier : {1, 10, 20})
+    {
+        float max_penetration = 0.0;
+        float max_rope_stretch = 0.0;
+        const BenchmarkResult result = run_xpbd(false, high_resolution_multiplier, 0, max_penetration, max_rope_stretch);
+        std::printf("  penalty x%-2zu            %-8s %.3f ms/tick max penetration %.3f rope stretch %.2f%%\n", high_resolution_multiplier, result.is_stable ? "stable" : "unstable", result.time_per_tick_ms, max_penetration, max_rope_stretch * 100);
+    }
+    for(const size_t iteration_nbr : {4, 8})
+    {
+        float max_penetration = 0.0;
+        float max_rope_stretch = 0.0;
+        const BenchmarkResult result = run_xpbd(true, 1, iteration_nbr, max_penetration, max_rope_stretch);
+        std::printf("  xpbd x1, %zu iterations  %-8s %.3f ms/tick max penetration %.3f rope stretch %.2f%%\n", iteration_nbr, result.is_stable ? "stable" : "unstable", result.time_per_tick_ms, max_penetration, max_rope_stretch * 100);
+    }
+}
+
+// 20 balles de taille 0.5 tirees sur un mur de cercles de taille 2, avec ou sans collision continue
+BenchmarkResult run_bullet(const bool is_continuous, const float speed, const size_t high_resolution_multiplier, size_t& tunnel_nbr)
+{
+    const size_t nbr_bullet = 20;
+    const size_t nbr_tick = 50;
+    const float dt_second = 0.01;
+
+    DotEngine engine;
+    engine.register_system_high_resolution(std::make_shared<DotBlockingCollisionEffect>());
+
+    // Mur le long de x = 0
+    for(int i = -20; i <= 20; i++)
+    {
+        std::shared_ptr<DotStaticRigidBody> wall_ptr = std::make_shared<DotStaticRigidBody>();
+        wall_ptr->set_size(2.0);
+        wall_ptr->set_mass(1.0);
+        wall_ptr->set_hardness(1e7);
+        wall_ptr->set_damping(100.0);
+        wall_ptr->set_position(Float2d(0.0, i * 3.0));
+        engine.register_body(wall_ptr);
+    }
+
+    std::vector<std::shared_ptr<DotDynamicRigidBody>> bullet_ptrs;
+    for(size_t i = 0; i < nbr_bullet; i++)
+    {
+        std::shared_ptr<DotDynamicRigidBody> bullet_ptr = std::make_shared<DotDynamicRigidBody>();
+        bullet_ptr->set_size(0.5);
+        bullet_ptr->set_mass(0.1);
+        bullet_ptr->set_hardness(1e7);
+        bullet_ptr->set_damping(100.0);
+        bullet_ptr->set_position(Float2d(-30.0 - (i * 0.37), -20.0 + (i * 2.1)));
+        bullet_ptr->set_speed(Float2d(speed, 0.0));
+        bullet_ptr->set_continuous_collision(is_continuous);
+        engine.register_body(bullet_ptr);
+        bullet_ptrs.push_back(bullet_ptr);
+    }
+
+    BenchmarkResult result;
+    result.is_stable = true;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t tick = 0; tick < nbr_tick; tick++) engine.update(dt_second, high_resolution_multiplier);
+    result.time_per_tick_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / nbr_tick;
+
+    tunnel_nbr = 0;
+    for(const std::shared_ptr<DotDynamicRigidBody>& bullet_ptr : bullet_ptrs)
+    {
+        const Float2d position = bullet_ptr->get_position();
+        result.is_stable &= is_finite(position.x()) && is_finite(position.y());
+        if( position.x() > 0.0 ) tunnel_nbr += 1;
+    }
+    return result;
+}
+
+void benchmark_bullet()
+{
+    std::printf("Bullets, 20 bullets of size 0.5 on a wall of size 2 circles, dt 0.01 s, 50 ticks\n");
+    const std::pair<float, size_t> configs[3] = {{300.0f, 10}, {1000.0f, 10}, {3000.0f, 20}};
+    for(const std::pair<float, size_t>& config : configs)
+    {
+        for(const bool is_continuous : {false, true})
+        {
+            size_t tunnel_nbr = 0;
+            const BenchmarkResult result = run_bullet(is_continuous, config.first, config.second, tunnel_nbr);
+            std::printf("  speed %-4.0f x%-2zu %-10s %-8s %.3f ms/tick tunneled %zu/20\n", config.first, config.second, is_continuous ? "continuous" : "discrete", result.is_stable ? "stable" : "unstable", result.time_per_tick_ms, tunnel_nbr);
+        }
+    }
+}
+
+// 100 forces de saut qui lisent les 30 memes murs, chacune ecrit son propre sauteur, elles doivent tenir sur un niveau
+bool benchmark_system_graph()
+{
+    const size_t nbr_force = 100;
+    const size_t nbr_wall = 30;
+
+    std::vector<std::shared_ptr<DotStaticRigidBody>> wall_ptrs;
+    for(size_t i = 0; i < nbr_wall; i++) wall_ptrs.push_back(std::make_shared<DotStaticRigidBody>());
+
+    std::vector<std::shared_ptr<DotStaticRigidBody>> jumper_ptrs;
+    std::vector<std::shared_ptr<DotSystemInterface>> shared_wall_system_ptrs;
+    std::vector<std::shared_ptr<DotSystemInterface>> shared_jumper_system_ptrs;
+    for(size_t i = 0; i < nbr_force; i++)
+    {
+        jumper_ptrs.push_back(std::make_shared<DotDynamicRigidBody>());
+
+        std::shared_ptr<DotJumpingForce> force_ptr = std::make_shared<DotJumpingForce>();
+        force_ptr->set_jumper(jumper_ptrs.back());
+        for(const std::shared_ptr<DotStaticRigidBody>& wall_ptr : wall_ptrs) force_ptr->add_wall(wall_ptr);
+        shared_wall_system_ptrs.push_back(force_ptr);
+
+        // Meme sauteur pour toutes, les ecritures se suivent
+        std::shared_ptr<DotJumpingForce> shared_jumper_force_ptr = std::make_shared<DotJumpingForce>();
+        shared_jumper_force_ptr->set_jumper(jumper_ptrs.front());
+        shared_jumper_system_ptrs.push_back(shared_jumper_force_ptr);
+    }
+
+    DotSystemGraph graph;
+    graph.build(shared_wall_system_ptrs);
+    const size_t shared_wall_level_nbr = graph.get_level_nbr();
+    graph.build(shared_jumper_system_ptrs);
+    const size_t shared_jumper_level_nbr = graph.get_level_nbr();
+
+    std::printf("System graph, %zu jump forces\n", nbr_force);
+    std::printf("  reading the same %zu walls  %zu levels\n", nbr_wall, shared_wall_level_nbr);
+    std::printf("  writing the same jumper     %zu levels\n", shared_jumper_level_nbr);
+    return shared_wall_level_nbr == 1 && shared_jumper_level_nbr == nbr_force;
+}
+
+int main(int argc, char** argv)
+{
+    const char* const scene = argc > 1 ? argv[1] : "";
+    if( std::strcmp(scene, "spring_chain") == 0 ) benchmark_spring_chain();
+    else if( std::strcmp(scene, "xpbd") == 0 ) benchmark_xpbd();
+    else if( std::strcmp(scene, "bullet") == 0 ) benchmark_bullet();
+    else if( std::strcmp(scene, "system_graph") == 0 ) return benchmark_system_graph() ? 0 : 1;
+    else
+    {
+        std::printf("usage: benchmark spring_chain | xpbd | bullet | system_graph\n");
+        return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include "../../src/dot_engine/physic_thread.hpp"
 #include "../../src/dot_engine/components/body/limited_dynamic_rigid_body.hpp"
 #include "../../src/dot_engine/components/body/static_rigid_body.hpp"
+#include "../../src/dot_engine/components/body/compound_rigid_body.hpp"
 #include "../../src/dot_engine/components/universal_law/gravity.hpp"
 #include "../../src/dot_engine/components/universal_law/drag.hpp"
 #include "../../src/dot_engine/components/force/targeted_force.hpp"
@@ -17,6 +18,7 @@ int main()
     const float dt_second = 0.01;
     const uint8_t force_resolution_multiplier = 10;
     MonitoredPysicThread physic_thread(dt_second, force_resolution_multiplier);
+    physic_thread.set_snapshot_enabled(true);
     DotEngine& engine = physic_thread.engine();
 
     auto window = sf::RenderWindow(sf::VideoMode({1080, 720}), "CMake SFML Project");
@@ -63,32 +65,18 @@ int main()
         engine.register_body(std::move(truc_ptr));
     }
 
-    std::shared_ptr<DotLimitedDynamicRigidBody> ball_ptr_1 = std::make_shared<DotLimitedDynamicRigidBody>(DotLimitedDynamicRigidBody());
-    ball_ptr_1->set_hardness(hard_hardness);
-    ball_ptr_1->set_damping(obj_damping);
-    ball_ptr_1->set_mass(5.0);
-    ball_ptr_1->set_size(10.0);
-    ball_ptr_1->set_position(Float2d(540.0, -350.0));
-    ball_ptr_1->set_max_speed(max_speed);
-    engine.register_body(ball_ptr_1);
-
-    std::shared_ptr<DotLimitedDynamicRigidBody> ball_ptr_2 = std::make_shared<DotLimitedDynamicRigidBody>(DotLimitedDynamicRigidBody());
-    ball_ptr_2->set_hardness(hard_hardness);
-    ball_ptr_2->set_damping(obj_damping);
-    ball_ptr_2->set_mass(5.0);
-    ball_ptr_2->set_size(10.0);
-    ball_ptr_2->set_position(Float2d(510.0, -350.0));
-    ball_ptr_2->set_max_speed(max_speed);
-    engine.register_body(ball_ptr_2);
-
-    std::shared_ptr<DotLimitedDynamicRigidBody> ball_ptr_3 = std::make_shared<DotLimitedDynamicRigidBody>(DotLimitedDynamicRigidBody());
-    ball_ptr_3->set_hardness(hard_hardness);
-    ball_ptr_3->set_damping(obj_damping);
-    ball_ptr_3->set_mass(5.0);
-    ball_ptr_3->set_size(10.0);
-    ball_ptr_3->set_position(Float2d(570.0, -350.0));
-    ball_ptr_3->set_max_speed(max_speed);
-    engine.register_body(ball_ptr_3);
+    // Triangle rigide de trois boules
+    std::shared_ptr<DotCompoundRigidBody> ball_triangle_ptr = std::make_shared<DotCompoundRigidBody>();
+    std::shared_ptr<DotCompoundPartRigidBody> ball_ptr_1 = ball_triangle_ptr->add_part(Float2d(540.0, -350.0 - 25.98), 10.0, 5.0);
+    std::shared_ptr<DotCompoundPartRigidBody> ball_ptr_2 = ball_triangle_ptr->add_part(Float2d(525.0, -350.0), 10.0, 5.0);
+    std::shared_ptr<DotCompoundPartRigidBody> ball_ptr_3 = ball_triangle_ptr->add_part(Float2d(555.0, -350.0), 10.0, 5.0);
+    ball_triangle_ptr->update_mass_properties();
+    for(const std::shared_ptr<DotCompoundPartRigidBody>& ball_ptr : {ball_ptr_1, ball_ptr_2, ball_ptr_3})
+    {
+        ball_ptr->set_hardness(hard_hardness);
+        ball_ptr->set_damping(obj_damping);
+        engine.register_body(ball_ptr);
+    }
 
     // Ajout d'un sol
     std::shared_ptr<DotStaticRigidBody> ground_ptr = std::make_shared<DotStaticRigidBody>(DotStaticRigidBody());
@@ -137,34 +125,6 @@ int main()
     player_run_force->set_running_value(player_run_force_magnitude);
     engine.register_system_low_resolution(player_run_force);
 
-    const float ball_spring_hardness = 10000.0; //hard_hardness;
-    const float ball_spring_damping = 100.0; //obj_damping;
-    const float ball_spring_length = 30.0;
-    std::shared_ptr<DotSpringLink> spring_1_2 = std::make_shared<DotSpringLink>(DotSpringLink());
-    spring_1_2->set_hardness(ball_spring_hardness);
-    spring_1_2->set_damping(ball_spring_damping);
-    spring_1_2->set_length(ball_spring_length);
-    spring_1_2->set_target_a(ball_ptr_1);
-    spring_1_2->set_target_b(ball_ptr_2);
-    engine.register_system_high_resolution(spring_1_2);
-
-    std::shared_ptr<DotSpringLink> spring_1_3 = std::make_shared<DotSpringLink>(DotSpringLink());
-    spring_1_3->set_hardness(ball_spring_hardness);
-    spring_1_3->set_damping(ball_spring_damping);
-    spring_1_3->set_length(ball_spring_length);
-    spring_1_3->set_target_a(ball_ptr_1);
-    spring_1_3->set_target_b(ball_ptr_3);
-    engine.register_system_high_resolution(spring_1_3);
-
-    std::shared_ptr<DotSpringLink> spring_2_3 = std::make_shared<DotSpringLink>(DotSpringLink());
-    spring_2_3->set_hardness(ball_spring_hardness);
-    spring_2_3->set_damping(ball_spring_damping);
-    spring_2_3->set_length(ball_spring_length);
-    spring_2_3->set_target_a(ball_ptr_2);
-    spring_2_3->set_target_b(ball_ptr_3);
-    engine.register_system_high_resolution(spring_2_3);
-
-
     // Ajout des formes pour l'affichage
     float display_scaling = 10.0;
     sf::CircleShape player_circle;
@@ -225,7 +185,9 @@ int main()
 
     // values to set
     int8_t set_player_run_dir = 0;
-    float player_jump = false;
+    bool player_jump = false;
+    int8_t sent_player_run_dir = 0;
+    bool sent_player_jump = false;
 
     //  Print counter
     int delta_print_itt = 0;
@@ -261,20 +223,34 @@ int main()
             player_jump = false;
         }
 
-        // Communication avec le moteur physique
-        physic_thread.lock();
-        // values to set
-        player_jump_force->set_is_active(player_jump);
-        player_run_force->set_direction(set_player_run_dir);
-
-        // values to get
-        player_size = player_ptr->get_size();
-        player_position = player_ptr->get_position();
-        ball_1_position = ball_ptr_1->get_position();
-        ball_2_position = ball_ptr_2->get_position();
-        ball_3_position = ball_ptr_3->get_position();
-        ground_1_position = ground_ptr->get_position();
-        ground_2_position = ground2_ptr->get_position();
+        // Lecture du dernier etat publie par le moteur physique, sans bloquer la physique
+        const DotEngineSnapshot& snapshot = physic_thread.read_snapshot();
+        if( snapshot.is_valid() )
+        {
+            const DotBodySnapshot* const player_snapshot = snapshot.get_body(player_ptr.get());
+            if( player_snapshot )
+            {
+                player_size = player_snapshot->size;
+                player_position = player_snapshot->position;
+            }
+            if( const DotBodySnapshot* const body_snapshot = snapshot.get_body(ball_ptr_1.get()) ) ball_1_position = body_snapshot->position;
+            if( const DotBodySnapshot* const body_snapshot = snapshot.get_body(ball_ptr_2.get()) ) ball_2_position = body_snapshot->position;
+            if( const DotBodySnapshot* const body_snapshot = snapshot.get_body(ball_ptr_3.get()) ) ball_3_position = body_snapshot->position;
+            if( const DotBodySnapshot* const body_snapshot = snapshot.get_body(ground_ptr.get()) ) ground_1_position = body_snapshot->position;
+            if( const DotBodySnapshot* const body_snapshot = snapshot.get_body(ground2_ptr.get()) ) ground_2_position = body_snapshot->position;
+        }
+
+        // Communication avec le moteur physique, par commandes sans bloquer la physique
+        if( player_jump != sent_player_jump )
+        {
+            engine.push_set_parameter(player_jump_force, &DotJumpingForce::set_is_active, player_jump);
+            sent_player_jump = player_jump;
+        }
+        if( set_player_run_dir != sent_player_run_dir )
+        {
+            engine.push_set_parameter(player_run_force, &DotRunningForce::set_direction, set_player_run_dir);
+            sent_player_run_dir = set_player_run_dir;
+        }
 
         // print dt
         if(delta_print_itt >= 60)
@@ -288,8 +264,6 @@ int main()
             delta_print_itt += 1;
         }
 
-        physic_thread.unlock();
-
         // Mise à jour des formes à afficher
         player_circle.setRadius(player_size*display_scaling);
         player_circle.setOrigin(sf::Vector2f(player_size*display_scaling, player_size*display_scaling));
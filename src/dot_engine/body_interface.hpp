@@ -1,24 +1,95 @@
 #include "./utils/float2d.hpp"
 #include "./utils/destroyable.hpp"
+#include "./utils/shape_core.hpp"
+#include <cstdint>
+#include <vector>
+#include <utility>
 
 #pragma once
 
+// Body type flags, a body has the flag of its class and of every class it derive from
+enum DotBodyTypeFlag : uint32_t {
+    BODY_TYPE_STATIC_RIGID = 1,
+    BODY_TYPE_DYNAMIC_RIGID = 2,
+    BODY_TYPE_LIMITED_DYNAMIC_RIGID = 4,
+    BODY_TYPE_COMPOUND_PART = 8
+};
+
+// Core of the body shape, the shape is the core grown by the body size
+// A segment grown by a size is a capsule, a box grown by a size is a rounded box
+enum DotShapeType : uint8_t {
+    SHAPE_CIRCLE,
+    SHAPE_SEGMENT,
+    SHAPE_BOX
+};
+
 class DotBodyInterface: public Destroyable{
     protected:
 
+    // Set by the constructors of the body classes, collision filters use it instead of a dynamic_cast
+    uint32_t m_body_type_flags;
+    // Compound of a compound part, the parts of a same compound are not tested against each other
+    const void* m_compound_key;
+    // Layers of the body, collision filters route the pairs by layer
+    uint32_t m_collision_layers;
+
     // Body position
     Float2d m_position;
     // Body size
     float m_size;
+    // Shape core, a point for a circle
+    DotShapeType m_shape_type;
+    // Half segment for a segment, axis aligned half extents for a box
+    Float2d m_shape_extent;
     // Body with weak collision cannot have collision with other body with weak collision
     bool m_weak_collision;
+    // Body with continuous collision is tested along its motion of the tick, so it cannot pass through thin bodies
+    bool m_continuous_collision;
+    // Pairs closer than the largest contact margin of the two bodies are reported as contacts too
+    float m_contact_margin;
+    // Margins requested by the systems, one per requester, the contact margin is the largest of them and of the set margin
+    std::vector<std::pair<const void*, float>> m_contact_margin_requests;
+    float m_requested_contact_margin;
+
+    void update_requested_contact_margin() {
+        m_requested_contact_margin = 0.0;
+        for(const std::pair<const void*, float>& request : m_contact_margin_requests) m_requested_contact_margin = std::max(m_requested_contact_margin, request.second);
+    }
+    // A sensor body stay in the broadphase, its pairs go to the sensor list instead of the collision list
+    bool m_sensor;
 
     public:
 
+    uint32_t get_body_type_flags() const { return m_body_type_flags; }
+    // Compound of a compound part, the parts of a same compound are not tested against each other
+    const void* get_compound_key() const { return m_compound_key; }
+    // Layers of the body, collision filters route the pairs by layer
+    uint32_t get_collision_layers() const { return m_collision_layers; }
+    // Layers of the body, collision filters route the pairs by layer
+    void set_collision_layers(const uint32_t value) { m_collision_layers = value; }
+
     // Body size
     void  set_size(const float value) {m_size = value; }
     // Body size
     float get_size() const {return m_size;}
+    DotShapeType get_shape_type() const { return m_shape_type; }
+    Float2d get_shape_extent() const { return m_shape_extent; }
+    void set_circle_shape() { m_shape_type = SHAPE_CIRCLE; m_shape_extent = Float2d(0,0); }
+    // Segment from position - half_segment to position + half_segment
+    void set_segment_shape(const Float2d& half_segment) { m_shape_type = SHAPE_SEGMENT; m_shape_extent = half_segment; }
+    // Axis aligned box of half extents, the corners are rounded by the body size
+    void set_box_shape(const Float2d& half_extent) { m_shape_type = SHAPE_BOX; m_shape_extent = half_extent; }
+    DotShapeCore get_shape_core() const {
+        if( m_shape_type == SHAPE_SEGMENT ) return DotShapeCore::segment(m_position, m_shape_extent);
+        if( m_shape_type == SHAPE_BOX ) return DotShapeCore(m_position, Float2d(1,0), m_shape_extent.x(), m_shape_extent.y());
+        return DotShapeCore(m_position, Float2d(1,0), 0.0, 0.0);
+    }
+    // Half extents of the axis aligned bounds of the shape
+    Float2d get_bound_half_extent() const {
+        if( m_shape_type == SHAPE_CIRCLE ) return Float2d(m_size, m_size);
+        return Float2d(std::abs(m_shape_extent.x()) + m_size, std::abs(m_shape_extent.y()) + m_size);
+    }
+
     // Body position
     void     set_position(const Float2d& value) {m_position = value;}
     // Body position
@@ -27,13 +98,52 @@ class DotBodyInterface: public Destroyable{
     bool has_weak_collision(){ return m_weak_collision; }
     // Body with weak collision cannot have collision with other body with weak collision
     void set_weak_collision(const bool value ){  m_weak_collision = value; }
+    // Body with continuous collision is tested along its motion of the tick, so it cannot pass through thin bodies
+    bool has_continuous_collision() const { return m_continuous_collision; }
+    // Body with continuous collision is tested along its motion of the tick, so it cannot pass through thin bodies
+    void set_continuous_collision(const bool value ){  m_continuous_collision = value; }
+    // Pairs closer than the largest contact margin of the two bodies are reported as contacts too
+    float get_contact_margin() const { return std::max(m_contact_margin, m_requested_contact_margin); }
+    // Pairs closer than the largest contact margin of the two bodies are reported as contacts too
+    void set_contact_margin(const float value ){  m_contact_margin = value; }
+    // Margin needed by requester, replace its previous request, the other requests are kept
+    void request_contact_margin(const void* const requester, const float value) {
+        release_contact_margin(requester);
+        m_contact_margin_requests.emplace_back(requester, value);
+        update_requested_contact_margin();
+    }
+    // Remove the margin request of requester
+    void release_contact_margin(const void* const requester) {
+        for(size_t i = 0; i < m_contact_margin_requests.size(); i++)
+        {
+            if( m_contact_margin_requests[i].first != requester ) continue;
+            std::swap(m_contact_margin_requests[i], m_contact_margin_requests.back());
+            m_contact_margin_requests.pop_back();
+            break;
+        }
+        update_requested_contact_margin();
+    }
+    // A sensor body stay in the broadphase, its pairs go to the sensor list instead of the collision list
+    bool is_sensor() const { return m_sensor; }
+    // A sensor body stay in the broadphase, its pairs go to the sensor list instead of the collision list
+    void set_sensor(const bool value ){  m_sensor = value; }
+    // Body speed, null for body that do not move
+    virtual Float2d get_speed() const { return Float2d(0,0); }
 
     // Function to overload
     virtual ~DotBodyInterface(){}
     DotBodyInterface():
+    m_body_type_flags(0),
+    m_compound_key(nullptr),
+    m_collision_layers(1),
     m_position(Float2d(0,0)),
     m_size(0),
-    m_weak_collision(false)
+    m_shape_type(SHAPE_CIRCLE),
+    m_weak_collision(false),
+    m_continuous_collision(false),
+    m_contact_margin(0.0),
+    m_requested_contact_margin(0.0),
+    m_sensor(false)
     {}
 
     virtual void on_low_resolution_loop_start( [[maybe_unused]] const float deltaTime){};
@@ -41,12 +151,68 @@ class DotBodyInterface: public Destroyable{
     virtual void on_high_resolution_loop_start( [[maybe_unused]] const float deltaTime){};
     virtual void on_high_resolution_loop_end( [[maybe_unused]] const float deltaTime){};
 
+    // A body that return true always do every high resolution step, even when the multi rate would step it once
+    virtual bool requires_high_resolution_steps() const { return false; }
+
+
+    // Largest contact margin of 2 bodies
+    static float getContactMargin( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b ) {
+        return std::max(body_a->get_contact_margin(), body_b->get_contact_margin());
+    }
+
+    // Distance between the surfaces of 2 bodies, negative when they overlap, normal point from a to b
+    static float getContact( const DotBodyInterface* const body_a, const DotBodyInterface* const body_b, Float2d& normal_a2b ) {
+        const float sizes = body_a->get_size() + body_b->get_size();
+        if( body_a->m_shape_type == SHAPE_CIRCLE && body_b->m_shape_type == SHAPE_CIRCLE )
+        {
+            const Float2d diff_a2b = body_b->get_position() - body_a->get_position();
+            const float dist = diff_a2b.norm();
+            normal_a2b = diff_a2b/dist;
+            return dist - sizes;
+        }
+        // A circle against a shape is a point distance
+        if( body_a->m_shape_type == SHAPE_CIRCLE )
+        {
+            const float distance = body_b->get_shape_core().get_point_distance(body_a->get_position(), normal_a2b);
+            normal_a2b = -normal_a2b;
+            return distance - sizes;
+        }
+        if( body_b->m_shape_type == SHAPE_CIRCLE ) return body_a->get_shape_core().get_point_distance(body_b->get_position(), normal_a2b) - sizes;
+        return DotShapeCore::get_distance(body_a->get_shape_core(), body_b->get_shape_core(), normal_a2b) - sizes;
+    }
+
+    // Distance between the surfaces of 2 bodies, negative when they overlap
+    static float getContactDistance( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b ) {
+        if( body_a->m_shape_type == SHAPE_CIRCLE && body_b->m_shape_type == SHAPE_CIRCLE )
+        {
+            return (body_b->get_position() - body_a->get_position()).norm() - (body_a->get_size() + body_b->get_size());
+        }
+        Float2d normal_a2b;
+        return getContact(body_a.get(), body_b.get(), normal_a2b);
+    }
+
+    // return true if 2 bodies overlap, without the contact margin nor the weak collision
+    static bool hasOverlap( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b ) {
+        if( body_a->m_shape_type == SHAPE_CIRCLE && body_b->m_shape_type == SHAPE_CIRCLE )
+        {
+            const float critical_dist = body_a->get_size() + body_b->get_size();
+            return (body_b->get_position() - body_a->get_position()).norm2() < critical_dist * critical_dist;
+        }
+        Float2d normal_a2b;
+        return getContact(body_a.get(), body_b.get(), normal_a2b) < 0.0;
+    }
 
-    // return true if 2 bodies touch
+    // return true if 2 bodies touch or are closer than their contact margin
     static bool hasCollision( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b ) {
 
         if( body_a->has_weak_collision() && body_b->has_weak_collision() ) return false;
 
+        if( body_a->m_shape_type != SHAPE_CIRCLE || body_b->m_shape_type != SHAPE_CIRCLE )
+        {
+            Float2d normal_a2b;
+            return getContact(body_a.get(), body_b.get(), normal_a2b) < getContactMargin(body_a, body_b);
+        }
+
         const float size_a = body_a->get_size();
         const float size_b = body_b->get_size();
         const Float2d pos_a = body_a->get_position();
@@ -55,9 +221,65 @@ class DotBodyInterface: public Destroyable{
         const Float2d diff_a2b = pos_b - pos_a;
         const float dist_sq = diff_a2b.norm2();
 
-        const float critical_dist = size_a + size_b;
+        const float critical_dist = size_a + size_b + getContactMargin(body_a, body_b);
         const float critical_dist_sq = critical_dist * critical_dist;
 
         return dist_sq < critical_dist_sq;
     }
+
+    // hasCollision that also give the surface distance and the overlap, with a single shape test for the non circle shapes
+    static bool hasCollision( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b, float& distance, bool& is_overlapping ) {
+        if( body_a->m_shape_type == SHAPE_CIRCLE && body_b->m_shape_type == SHAPE_CIRCLE )
+        {
+            if( !hasCollision(body_a, body_b) ) return false;
+            distance = getContactDistance(body_a, body_b);
+            is_overlapping = hasOverlap(body_a, body_b);
+            return true;
+        }
+
+        if( body_a->has_weak_collision() && body_b->has_weak_collision() ) return false;
+        Float2d normal_a2b;
+        distance = getContact(body_a.get(), body_b.get(), normal_a2b);
+        is_overlapping = distance < 0.0;
+        return distance < getContactMargin(body_a, body_b);
+    }
+
+    // return true if 2 bodies touch, or come closer than their contact margin, while moving by their sweep
+    // The closest approach of the linear motions is tested
+    static bool hasContinuousCollision( const std::shared_ptr<DotBodyInterface>& body_a, const std::shared_ptr<DotBodyInterface>& body_b, const Float2d& sweep_a, const Float2d& sweep_b ) {
+
+        if( body_a->has_weak_collision() && body_b->has_weak_collision() ) return false;
+
+        const float critical_dist = body_a->get_size() + body_b->get_size() + getContactMargin(body_a, body_b);
+        const Float2d diff_a2b = body_b->get_position() - body_a->get_position();
+        const Float2d sweep_a2b = sweep_b - sweep_a;
+
+        if( body_a->m_shape_type != SHAPE_CIRCLE || body_b->m_shape_type != SHAPE_CIRCLE )
+        {
+            // A circle moving relatively to the other shape cover a segment, the exact test is a core distance
+            Float2d normal_a2b;
+            if( body_b->m_shape_type == SHAPE_CIRCLE )
+            {
+                return DotShapeCore::get_distance(body_a->get_shape_core(), DotShapeCore::segment(body_b->get_position() + (sweep_a2b / 2), sweep_a2b / 2), normal_a2b) < critical_dist;
+            }
+            if( body_a->m_shape_type == SHAPE_CIRCLE )
+            {
+                return DotShapeCore::get_distance(DotShapeCore::segment(body_a->get_position() - (sweep_a2b / 2), -sweep_a2b / 2), body_b->get_shape_core(), normal_a2b) < critical_dist;
+            }
+
+            // Two shapes are tested where their centers are closest
+            const float sweep_norm2 = sweep_a2b.norm2();
+            const float t = sweep_norm2 > 0.0 ? std::clamp(-Float2d::dot_product(diff_a2b, sweep_a2b) / sweep_norm2, 0.0f, 1.0f) : 0.0f;
+            DotShapeCore core_b = body_b->get_shape_core();
+            core_b.center += sweep_a2b * t;
+            return DotShapeCore::get_distance(body_a->get_shape_core(), core_b, normal_a2b) < critical_dist;
+        }
+
+        // Fraction of the sweep where the distance is minimal
+        const float sweep_norm2 = sweep_a2b.norm2();
+        const float t = sweep_norm2 > 0.0 ? std::clamp(-Float2d::dot_product(diff_a2b, sweep_a2b) / sweep_norm2, 0.0f, 1.0f) : 0.0f;
+        const Float2d closest_diff_a2b = diff_a2b + (sweep_a2b * t);
+
+        return closest_diff_a2b.norm2() < critical_dist * critical_dist;
+    }
 };
\ No newline at end of file
@@ -9,10 +9,11 @@ constexpr size_t COLLISION_SORTER_MAX_DEPT = 7;
 constexpr size_t COLLISION_SORTER_MINIMUM_BODY = 128;
 
 constexpr size_t ZONES_RESULT_MEMORY_SEGMENT_NBR = 500;
+// Thread local so engines updated on different threads do not share it
 class ZonesResultMemory{
     private:
-        static std::array<std::vector<size_t>,4> zones_result[ZONES_RESULT_MEMORY_SEGMENT_NBR];
-        static size_t counter;
+        static thread_local std::array<std::vector<size_t>,4> zones_result[ZONES_RESULT_MEMORY_SEGMENT_NBR];
+        static thread_local size_t counter;
     public:
         static bool available() noexcept
         {
@@ -27,11 +28,12 @@ class ZonesResultMemory{
             counter = 0;
         }
 };
-std::array<std::vector<size_t>,4> ZonesResultMemory::zones_result[ZONES_RESULT_MEMORY_SEGMENT_NBR];
-size_t ZonesResultMemory::counter = 0;
+thread_local std::array<std::vector<size_t>,4> ZonesResultMemory::zones_result[ZONES_RESULT_MEMORY_SEGMENT_NBR];
+thread_local size_t ZonesResultMemory::counter = 0;
 
 void collision_quad_sort(
     const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs, 
+    const std::vector<Float2d>& body_sweeps, 
     const std::vector<size_t>& body_ids, 
     std::vector<size_t>& zone_hybrid_result,
     std::vector<std::array<bool, 4>>& zone_hybrid_valid_result,
@@ -65,15 +67,29 @@ void collision_quad_sort(
     for(size_t i = 0 ; i < nbr_body; i++)
     {
         const Float2d position = body_ptrs[body_ids[i]]->get_position();
-        const float size = body_ptrs[body_ids[i]]->get_size();
+        // Bounds of the shape grown by the contact margin, so the pairs closer than the margin share a pool
+        const Float2d bound_half_extent = body_ptrs[body_ids[i]]->get_bound_half_extent();
+        const float contact_margin = body_ptrs[body_ids[i]]->get_contact_margin();
+        const float size_x = bound_half_extent.x() + contact_margin;
+        const float size_y = bound_half_extent.y() + contact_margin;
         const float x = position.x();
         const float y = position.y();
 
-        const float min_x = x-size;
-        const float min_y = y-size;
+        float min_x = x-size_x;
+        float min_y = y-size_y;
 
-        const float max_x = x+size;
-        const float max_y = y+size;
+        float max_x = x+size_x;
+        float max_y = y+size_y;
+
+        // Continuous collision bodies cover their whole motion of the tick
+        if( !body_sweeps.empty() )
+        {
+            const Float2d& sweep = body_sweeps[body_ids[i]];
+            min_x += std::min(sweep.x(), 0.0f);
+            min_y += std::min(sweep.y(), 0.0f);
+            max_x += std::max(sweep.x(), 0.0f);
+            max_y += std::max(sweep.y(), 0.0f);
+        }
 
         std::array<bool, 4> zone_hybrid_valid {{false,false,false,false}};
         uint8_t nbr_zone = 0;
@@ -128,6 +144,7 @@ void collision_quad_sort(
 
 size_t generate_collision_pool_imp(
     const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs, 
+    const std::vector<Float2d>& body_sweeps, 
     const std::vector<size_t>& body_ids, 
     std::vector<std::vector<size_t>>& out, 
     const size_t initial_out_size, 
@@ -158,7 +175,7 @@ size_t generate_collision_pool_imp(
 
     std::array<std::vector<size_t>,4> backup;
     std::array<std::vector<size_t>,4> zones_result = ZonesResultMemory::available() ? ZonesResultMemory::get() : backup;
-    collision_quad_sort(body_ptrs, body_ids, zone_hybrid_result, zone_hybrid_valid_result, zones_result);
+    collision_quad_sort(body_ptrs, body_sweeps, body_ids, zone_hybrid_result, zone_hybrid_valid_result, zones_result);
     const size_t zones_sizes[4] = {zones_result[0].size(), zones_result[1].size(), zones_result[2].size(), zones_result[3].size()};
     const size_t hybrid_size = zone_hybrid_result.size();
 
@@ -206,13 +223,14 @@ size_t generate_collision_pool_imp(
 
     for( uint8_t k = 0; k < 4; k++)
     {
-        size_out = generate_collision_pool_imp(body_ptrs, zones_result[k], out, size_out, depth + 1, zone_hybrid_result, zone_hybrid_valid_result);
+        size_out = generate_collision_pool_imp(body_ptrs, body_sweeps, zones_result[k], out, size_out, depth + 1, zone_hybrid_result, zone_hybrid_valid_result);
     }
 
     return size_out;
 }
 
-void generate_collision_pool(const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs, std::vector<std::vector<size_t>>& out_buffer) noexcept
+// body_sweeps hold the motion of the tick of every body, empty when no body has continuous collision
+void generate_collision_pool(const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs, const std::vector<Float2d>& body_sweeps, std::vector<std::vector<size_t>>& out_buffer) noexcept
 {
     ZonesResultMemory::reset();
 
@@ -224,12 +242,12 @@ void generate_collision_pool(const std::vector<std::shared_ptr<DotBodyInterface>
 
     out_buffer.resize(nbr_body);
 
-    static std::vector<size_t> zone_hybrid_result;
-    static std::vector<std::array<bool, 4>> zone_hybrid_valid_result;
+    thread_local std::vector<size_t> zone_hybrid_result;
+    thread_local std::vector<std::array<bool, 4>> zone_hybrid_valid_result;
     zone_hybrid_result.clear();
     zone_hybrid_valid_result.clear();
 
-    const size_t out_size = generate_collision_pool_imp(body_ptrs, body_ids, out_buffer, 0, 0, zone_hybrid_result, zone_hybrid_valid_result);
+    const size_t out_size = generate_collision_pool_imp(body_ptrs, body_sweeps, body_ids, out_buffer, 0, 0, zone_hybrid_result, zone_hybrid_valid_result);
 
     out_buffer.resize(out_size);
 
@@ -0,0 +1,285 @@
+#include "./dynamic_rigid_body.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#pragma once
+
+class DotCompoundRigidBody;
+
+// Circle of a compound rigid body, each part is a body of the engine for the collisions and the forces
+class DotCompoundPartRigidBody: public DotDynamicRigidBody{
+    friend class DotCompoundRigidBody;
+
+    protected:
+    std::shared_ptr<DotCompoundRigidBody> m_compound_ptr;
+    // Position in the compound frame
+    Float2d m_offset;
+
+    // Forces of the current step and of the next one, indexed by the parity of the step in the tick, so a part
+    // can read the forces of the other parts while they already accumulate the next step
+    Float2d m_forces[2];
+    Float2d m_force_derivatives[2];
+    Float2d m_low_res_force;
+    Float2d m_low_res_force_derivative;
+    size_t m_step;
+
+    // Copy of the compound state, every part integrate the same state so no part write the state of an other part
+    Float2d m_compound_position;
+    Float2d m_compound_speed;
+    float m_compound_angle;
+    float m_compound_angular_speed;
+
+    public:
+    DotCompoundPartRigidBody(std::shared_ptr<DotCompoundRigidBody> compound_ptr):
+    m_compound_ptr(std::move(compound_ptr)),
+    m_step(0),
+    m_compound_angle(0.0),
+    m_compound_angular_speed(0.0)
+    {
+        m_body_type_flags |= BODY_TYPE_COMPOUND_PART;
+        m_compound_key = m_compound_ptr.get();
+    }
+
+    DotCompoundPartRigidBody(const DotCompoundPartRigidBody&) = delete;
+    virtual ~DotCompoundPartRigidBody();
+
+    const std::shared_ptr<DotCompoundRigidBody>& get_compound() const { return m_compound_ptr; }
+
+    virtual void addForce( const Float2d& force, const Float2d& force_derivation = Float2d(0.f, 0.f)) {
+        const size_t slot = m_step & 1;
+        m_forces[slot] += force;
+        m_force_derivatives[slot] += force_derivation;
+    }
+
+    // The speed of a part is rebuilt from the compound, the impulse is given to the compound at the part position
+    virtual void apply_impulse( const Float2d& impulse );
+
+    virtual void on_low_resolution_loop_start( const float deltaTime);
+    virtual void on_low_resolution_loop_end( [[maybe_unused]] const float deltaTime){
+        const size_t slot = m_step & 1;
+        m_low_res_force = m_forces[slot];
+        m_low_res_force_derivative = m_force_derivatives[slot];
+    }
+    virtual void on_high_resolution_loop_start( [[maybe_unused]] const float deltaTime){
+        const size_t slot = m_step & 1;
+        m_forces[slot] = m_low_res_force;
+        m_force_derivatives[slot] = m_low_res_force_derivative;
+    }
+    virtual void on_high_resolution_loop_end( const float deltaTime);
+
+    // A part read the forces of the other parts at the end of a step, so the start and the end of a step
+    // must be in different body passes, the single step of the multi rate does both in one pass
+    virtual bool requires_high_resolution_steps() const { return true; }
+};
+
+// Set of circles with fixed offsets integrated as one rigid body with mass, inertia and angular speed
+// Create it with std::make_shared, add the parts, call update_mass_properties then register the parts in the engine
+class DotCompoundRigidBody: public std::enable_shared_from_this<DotCompoundRigidBody>{
+    friend class DotCompoundPartRigidBody;
+
+    private:
+    std::vector<DotCompoundPartRigidBody*> m_part_ptrs;
+    float m_mass;
+    float m_inertia;
+
+    void remove_part(DotCompoundPartRigidBody* const part_ptr);
+    void remove_destroyed_parts();
+    void integrate_part(DotCompoundPartRigidBody& part, const float deltaTime) const;
+    void write_part_state(DotCompoundPartRigidBody& part) const;
+
+    public:
+    DotCompoundRigidBody():
+    m_mass(0.0),
+    m_inertia(0.0)
+    {}
+
+    DotCompoundRigidBody(const DotCompoundRigidBody&) = delete;
+
+    // Part at a world position, the hardness and damping are set on the returned part
+    std::shared_ptr<DotCompoundPartRigidBody> add_part(const Float2d& position, const float size, const float mass);
+
+    // Compute mass, center of mass and inertia from the current part positions, to call after adding parts
+    void update_mass_properties();
+
+    size_t get_part_nbr() const { return m_part_ptrs.size(); }
+    float get_mass() const { return m_mass; }
+    float get_inertia() const { return m_inertia; }
+
+    // Compound state, read from the first part, !!! LOCK BEFORE !!!
+    Float2d get_position() const { return m_part_ptrs.empty() ? Float2d() : m_part_ptrs[0]->m_compound_position; }
+    Float2d get_speed() const { return m_part_ptrs.empty() ? Float2d() : m_part_ptrs[0]->m_compound_speed; }
+    float get_angle() const { return m_part_ptrs.empty() ? 0.0 : m_part_ptrs[0]->m_compound_angle; }
+    float get_angular_speed() const { return m_part_ptrs.empty() ? 0.0 : m_part_ptrs[0]->m_compound_angular_speed; }
+
+    // Set the compound speed of every part, !!! LOCK BEFORE !!!
+    void set_speed(const Float2d& speed, const float angular_speed = 0.0);
+
+    // Instant change of the compound speed and angular speed by an impulse at a world position, !!! LOCK BEFORE !!!
+    void apply_impulse(const Float2d& position, const Float2d& impulse);
+};
+
+DotCompoundPartRigidBody::~DotCompoundPartRigidBody()
+{
+    m_compound_ptr->remove_part(this);
+}
+
+void DotCompoundPartRigidBody::apply_impulse( const Float2d& impulse )
+{
+    m_compound_ptr->apply_impulse(m_position, impulse);
+}
+
+void DotCompoundPartRigidBody::on_low_resolution_loop_start( [[maybe_unused]] const float deltaTime)
+{
+    // The engine call it one body after the other, the compound can drop its destroyed parts
+    m_compound_ptr->remove_destroyed_parts();
+    // Every part do the same steps in a tick, restarting the parity keep the parts registered on different ticks in phase
+    m_step = 0;
+    m_forces[0] = get_total_constant_force();
+    m_force_derivatives[0] = Float2d();
+}
+
+void DotCompoundPartRigidBody::on_high_resolution_loop_end( const float deltaTime)
+{
+    m_compound_ptr->integrate_part(*this, deltaTime);
+    m_step += 1;
+}
+
+std::shared_ptr<DotCompoundPartRigidBody> DotCompoundRigidBody::add_part(const Float2d& position, const float size, const float mass)
+{
+    std::shared_ptr<DotCompoundPartRigidBody> part_ptr = std::make_shared<DotCompoundPartRigidBody>(shared_from_this());
+    part_ptr->set_position(position);
+    part_ptr->set_size(size);
+    part_ptr->set_mass(mass);
+    part_ptr->m_compound_position = position;
+    m_part_ptrs.push_back(part_ptr.get());
+    return part_ptr;
+}
+
+void DotCompoundRigidBody::remove_part(DotCompoundPartRigidBody* const part_ptr)
+{
+    const std::vector<DotCompoundPartRigidBody*>::iterator it = std::find(m_part_ptrs.begin(), m_part_ptrs.end(), part_ptr);
+    if( it == m_part_ptrs.end() ) return;
+    m_part_ptrs.erase(it);
+    update_mass_properties();
+}
+
+void DotCompoundRigidBody::remove_destroyed_parts()
+{
+    // A destroyed part can be kept alive by its owner, it must stop to give its mass and its forces
+    const std::vector<DotCompoundPartRigidBody*>::iterator it = std::remove_if(m_part_ptrs.begin(), m_part_ptrs.end(), [](const DotCompoundPartRigidBody* const part_ptr){ return part_ptr->is_destroyed(); });
+    if( it == m_part_ptrs.end() ) return;
+    m_part_ptrs.erase(it, m_part_ptrs.end());
+    update_mass_properties();
+}
+
+void DotCompoundRigidBody::update_mass_properties()
+{
+    if( m_part_ptrs.empty() ) return;
+
+    // Motion of the compound is kept, the frame is reset to the current part positions
+    const DotCompoundPartRigidBody& reference = *m_part_ptrs[0];
+    const Float2d old_position = reference.m_compound_position;
+    const Float2d old_speed = reference.m_compound_speed;
+    const float angular_speed = reference.m_compound_angular_speed;
+
+    m_mass = 0.0;
+    Float2d weighted_position_sum;
+    for( const DotCompoundPartRigidBody* const part_ptr : m_part_ptrs )
+    {
+        m_mass += part_ptr->m_mass;
+        weighted_position_sum += part_ptr->m_position * part_ptr->m_mass;
+    }
+    const Float2d position = m_mass > 0.0 ? weighted_position_sum / m_mass : m_part_ptrs[0]->m_position;
+    const Float2d speed = old_speed + ((position - old_position).perpendicular_counterclock() * angular_speed);
+
+    m_inertia = 0.0;
+    for( DotCompoundPartRigidBody* const part_ptr : m_part_ptrs )
+    {
+        part_ptr->m_offset = part_ptr->m_position - position;
+        m_inertia += part_ptr->m_mass * (part_ptr->m_offset.norm2() + (part_ptr->m_size * part_ptr->m_size / 2));
+
+        part_ptr->m_compound_position = position;
+        part_ptr->m_compound_speed = speed;
+        part_ptr->m_compound_angle = 0.0;
+        part_ptr->m_compound_angular_speed = angular_speed;
+        write_part_state(*part_ptr);
+    }
+}
+
+void DotCompoundRigidBody::set_speed(const Float2d& speed, const float angular_speed)
+{
+    for( DotCompoundPartRigidBody* const part_ptr : m_part_ptrs )
+    {
+        part_ptr->m_compound_speed = speed;
+        part_ptr->m_compound_angular_speed = angular_speed;
+        write_part_state(*part_ptr);
+    }
+}
+
+void DotCompoundRigidBody::apply_impulse(const Float2d& position, const Float2d& impulse)
+{
+    if( m_part_ptrs.empty() ) return;
+
+    const Float2d arm = position - m_part_ptrs[0]->m_compound_position;
+    const Float2d delta_speed = m_mass > 0.0 ? impulse / m_mass : Float2d();
+    const float delta_angular_speed = m_inertia > 0.0 ? ((arm.x()*impulse.y()) - (arm.y()*impulse.x())) / m_inertia : 0.0;
+    for( DotCompoundPartRigidBody* const part_ptr : m_part_ptrs )
+    {
+        part_ptr->m_compound_speed += delta_speed;
+        part_ptr->m_compound_angular_speed += delta_angular_speed;
+        write_part_state(*part_ptr);
+    }
+}
+
+void DotCompoundRigidBody::write_part_state(DotCompoundPartRigidBody& part) const
+{
+    const float cos_angle = cosf(part.m_compound_angle);
+    const float sin_angle = sinf(part.m_compound_angle);
+    const Float2d arm = Float2d(cos_angle*part.m_offset.x() - sin_angle*part.m_offset.y(), sin_angle*part.m_offset.x() + cos_angle*part.m_offset.y());
+
+    part.m_position = part.m_compound_position + arm;
+    part.m_speed = part.m_compound_speed + (arm.perpendicular_counterclock() * part.m_compound_angular_speed);
+}
+
+void DotCompoundRigidBody::integrate_part(DotCompoundPartRigidBody& part, const float deltaTime) const
+{
+    // Sum of the forces and torques of the step, the lever arms come from the state copy of this part
+    const size_t slot = part.m_step & 1;
+    const float cos_angle = cosf(part.m_compound_angle);
+    const float sin_angle = sinf(part.m_compound_angle);
+
+    Float2d force;
+    Float2d force_derivative;
+    float torque = 0.0;
+    float torque_derivative = 0.0;
+    for( const DotCompoundPartRigidBody* const part_ptr : m_part_ptrs )
+    {
+        // Destroyed during the tick, the part is removed at the next low resolution loop start
+        if( part_ptr->is_destroyed() ) continue;
+        const Float2d& offset = part_ptr->m_offset;
+        const Float2d arm = Float2d(cos_angle*offset.x() - sin_angle*offset.y(), sin_angle*offset.x() + cos_angle*offset.y());
+        const Float2d& part_force = part_ptr->m_forces[slot];
+        const Float2d& part_force_derivative = part_ptr->m_force_derivatives[slot];
+
+        force += part_force;
+        force_derivative += part_force_derivative;
+        torque += (arm.x()*part_force.y()) - (arm.y()*part_force.x());
+        torque_derivative += (arm.x()*part_force_derivative.y()) - (arm.y()*part_force_derivative.x());
+    }
+
+    const float deltaTime_2 = deltaTime * deltaTime;
+    const float deltaTime_3 = deltaTime_2 * deltaTime;
+
+    const Float2d acceleration = m_mass > 0.0 ? force / m_mass : Float2d();
+    const Float2d acceleration_derive = m_mass > 0.0 ? force_derivative / m_mass : Float2d();
+    part.m_compound_position += (part.m_compound_speed*deltaTime) + ((acceleration/2)*deltaTime_2) + ((acceleration_derive/6) * deltaTime_3);
+    part.m_compound_speed += (acceleration*deltaTime) + ((acceleration_derive/2) * deltaTime_2);
+
+    const float angular_acceleration = m_inertia > 0.0 ? torque / m_inertia : 0.0;
+    const float angular_acceleration_derive = m_inertia > 0.0 ? torque_derivative / m_inertia : 0.0;
+    part.m_compound_angle += (part.m_compound_angular_speed*deltaTime) + ((angular_acceleration/2)*deltaTime_2) + ((angular_acceleration_derive/6) * deltaTime_3);
+    part.m_compound_angular_speed += (angular_acceleration*deltaTime) + ((angular_acceleration_derive/2) * deltaTime_2);
+
+    write_part_state(part);
+}
@@ -10,10 +10,34 @@ class DotDynamicRigidBody: public DotStaticRigidBody{
     Float2d m_low_res_acceleration;
     Float2d m_low_res_acceleration_derive;
 
+    // Forces that do not change between ticks, they seed the acceleration at the start of every tick
+    Float2d m_constant_force;
+    Float2d m_constant_acceleration;
+
     public:
 
+    DotDynamicRigidBody(){ m_body_type_flags |= BODY_TYPE_DYNAMIC_RIGID; }
+
     void set_speed( const Float2d& value ) { m_speed = value; }
 
+    // Instant speed change of impulse / mass
+    virtual void apply_impulse( const Float2d& impulse ) { m_speed += impulse/m_mass; }
+
+    // Acceleration accumulated by the forces applied since the start of the loop
+    Float2d get_acceleration() const { return m_acceleration; }
+    Float2d get_acceleration_derive() const { return m_acceleration_derive; }
+
+    // Constant force applied every tick from the next tick, remove it by adding its opposite, !!! LOCK BEFORE !!!
+    Float2d get_constant_force() const { return m_constant_force; }
+    void add_constant_force( const Float2d& force ) { m_constant_force += force; }
+
+    // Constant acceleration applied every tick from the next tick whatever the mass, remove it by adding its opposite, !!! LOCK BEFORE !!!
+    Float2d get_constant_acceleration() const { return m_constant_acceleration; }
+    void add_constant_acceleration( const Float2d& acceleration ) { m_constant_acceleration += acceleration; }
+
+    // Constant forces as a single force for the current mass
+    Float2d get_total_constant_force() const { return m_constant_force + (m_constant_acceleration * m_mass); }
+
     virtual void resetForce(){
         m_acceleration = Float2d(0.0, 0.0);
         m_acceleration_derive = Float2d(0.0, 0.0);
@@ -26,7 +50,7 @@ class DotDynamicRigidBody: public DotStaticRigidBody{
 
 
     virtual void on_low_resolution_loop_start( [[maybe_unused]] const float deltaTime){
-        m_acceleration = Float2d();
+        m_acceleration = m_mass != 0.0 ? m_constant_acceleration + (m_constant_force/m_mass) : m_constant_acceleration;
         m_acceleration_derive = Float2d();
     }
     virtual void on_low_resolution_loop_end( [[maybe_unused]] const float deltaTime){
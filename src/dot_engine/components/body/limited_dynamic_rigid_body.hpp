@@ -7,6 +7,8 @@ class DotLimitedDynamicRigidBody: public DotDynamicRigidBody{
     float m_max_speed;
 
     public:
+
+    DotLimitedDynamicRigidBody(){ m_body_type_flags |= BODY_TYPE_LIMITED_DYNAMIC_RIGID; }
     
     float get_max_speed() { return m_max_speed; }
     void set_max_speed( const float& value ) { m_max_speed = value; }
@@ -11,6 +11,12 @@ class DotStaticRigidBody: public DotBodyInterface{
 
     public:
 
+    DotStaticRigidBody():
+    m_mass(0.0),
+    m_hardness(0.0),
+    m_damping(0.0)
+    { m_body_type_flags |= BODY_TYPE_STATIC_RIGID; }
+
     float get_mass() { return m_mass; }
     void set_mass( const float value ) { m_mass = value; }
 
@@ -20,7 +26,7 @@ class DotStaticRigidBody: public DotBodyInterface{
     float get_damping() { return m_damping; }
     void set_damping( const float value ) { m_damping = value; }
 
-    Float2d get_speed() { return m_speed; }
+    virtual Float2d get_speed() const { return m_speed; }
 
     virtual void addForce( [[maybe_unused]] const Float2d& force, [[maybe_unused]] const Float2d& force_derivation = Float2d(0.f, 0.f)){};
 
@@ -1,8 +1,17 @@
 #include "../../system_interface.hpp"
+#include "../../physic_multithread_helper.hpp"
 #include "../body/static_rigid_body.hpp"
+#include "../body/dynamic_rigid_body.hpp"
+#include <unordered_map>
+#include <cstring>
 
 #pragma once
 
+// Batch smaller than this are applied on the calling thread
+constexpr size_t BLOCKING_COLLISION_MULTITHREAD_MINIMUM_BATCH = 64;
+// Number of color usable by the graph coloring, contacts that do not fit go in a serial batch
+constexpr size_t BLOCKING_COLLISION_MAX_COLOR = 64;
+
 struct BlockingCollisionInfo
 {
     DotStaticRigidBody* const body_a;
@@ -25,73 +34,216 @@ class DotBlockingCollisionEffect : public DotSystemInterface
     private:
     std::vector<BlockingCollisionInfo> m_collision_bodies_buffer;
 
+    // Contact ids sorted by color, no two contacts of a same color share a dynamic body
+    std::vector<size_t> m_colored_collision_ids;
+    std::vector<size_t> m_color_offsets;
+    std::vector<uint8_t> m_collision_colors;
+    std::unordered_map<const DotStaticRigidBody*, uint64_t> m_body_color_masks;
+    float m_max_stiffness_to_mass_ratio;
+
+    std::function<void(const DotThreadTask&)> m_apply_multithread_function;
+    size_t m_apply_batch_offset;
+
+    void color_collisions();
+    void apply_multithread_function(const DotThreadTask& task);
+
+    static void apply_collision(const BlockingCollisionInfo& info);
+
     public:
+    DotBlockingCollisionEffect():
+    m_color_offsets(1, 0),
+    m_max_stiffness_to_mass_ratio(0.0),
+    m_apply_multithread_function(std::bind(&DotBlockingCollisionEffect::apply_multithread_function, this, std::placeholders::_1)),
+    m_apply_batch_offset(0)
+    {}
+
+    DotBlockingCollisionEffect([[maybe_unused]] const DotBlockingCollisionEffect& other):
+    DotBlockingCollisionEffect()
+    {}
+
     virtual ~DotBlockingCollisionEffect(){}
 
+    virtual bool get_collision_filter(DotCollisionFilter& filter) const {
+        filter.body_type_flags = BODY_TYPE_STATIC_RIGID;
+        filter.touching_only = true;
+        return true;
+    }
+
     virtual void on_collision_list_update([[maybe_unused]] const std::vector<DotCollisionInfo>& collision_infos){
         m_collision_bodies_buffer.clear();
+        // The collision filter only let the touching pairs of rigid bodies through
         for( const DotCollisionInfo& info : collision_infos )
         {
-            DotStaticRigidBody* const body_a = dynamic_cast<DotStaticRigidBody* const>(info.body_a);
-            if(!body_a) continue;
-            DotStaticRigidBody* const body_b = dynamic_cast<DotStaticRigidBody* const>(info.body_b);
-            if(!body_b) continue;
-            m_collision_bodies_buffer.emplace_back(body_a,body_b);
+            m_collision_bodies_buffer.emplace_back(static_cast<DotStaticRigidBody*>(info.body_a),static_cast<DotStaticRigidBody*>(info.body_b));
+        }
+
+        // The contact list is the same for every high resolution step, so the coloring is done once here
+        color_collisions();
+    }
+
+    virtual float get_max_stiffness_to_mass_ratio() const { return m_max_stiffness_to_mass_ratio; }
+
+    // Bodies of the current contacts, the contact list does not change during the high resolution loop
+    virtual bool declare_high_resolution_bodies(DotSystemAccess& access) const {
+        for( const BlockingCollisionInfo& info : m_collision_bodies_buffer )
+        {
+            access.write_bodies.push_back(info.body_a);
+            access.write_bodies.push_back(info.body_b);
         }
+        return true;
     }
 
     virtual void apply( const float delta_t)
     {
-        for( const BlockingCollisionInfo& info : m_collision_bodies_buffer )
+        const size_t nbr_color = m_color_offsets.size() - 1;
+        for( size_t color = 0; color < nbr_color; color++ )
+        {
+            const size_t batch_start = m_color_offsets[color];
+            const size_t batch_size = m_color_offsets[color+1] - batch_start;
+
+            // Last batch hold the contacts that could not be colored
+            const bool is_serial_batch = color == (nbr_color - 1);
+            if( is_serial_batch || batch_size < BLOCKING_COLLISION_MULTITHREAD_MINIMUM_BATCH || !m_multi_thread_helper_ptr )
+            {
+                for( size_t i = batch_start; i < batch_start + batch_size; i++ )
+                {
+                    apply_collision(m_collision_bodies_buffer[m_colored_collision_ids[i]]);
+                }
+            }
+            else
+            {
+                m_apply_batch_offset = batch_start;
+                m_multi_thread_helper_ptr->custom_function(delta_t, batch_size, &m_apply_multithread_function);
+            }
+        }
+    }
+};
+
+void DotBlockingCollisionEffect::color_collisions()
+{
+    // Greedy coloring, a contact take the first color not used by one of its bodies
+    // Static bodies ignore forces, so they do not constrain the coloring
+    const size_t nbr_collision = m_collision_bodies_buffer.size();
+    m_body_color_masks.clear();
+    m_collision_colors.resize(nbr_collision);
+    m_max_stiffness_to_mass_ratio = 0.0;
+
+    size_t color_sizes[BLOCKING_COLLISION_MAX_COLOR + 1] = {};
+    for( size_t i = 0; i < nbr_collision; i++ )
+    {
+        const BlockingCollisionInfo& info = m_collision_bodies_buffer[i];
+        const bool is_dynamic_a = info.body_a->get_body_type_flags() & BODY_TYPE_DYNAMIC_RIGID;
+        const bool is_dynamic_b = info.body_b->get_body_type_flags() & BODY_TYPE_DYNAMIC_RIGID;
+        uint64_t* const mask_a = is_dynamic_a ? &m_body_color_masks[info.body_a] : nullptr;
+        uint64_t* const mask_b = is_dynamic_b ? &m_body_color_masks[info.body_b] : nullptr;
+        const uint64_t used_colors = (mask_a ? *mask_a : 0) | (mask_b ? *mask_b : 0);
+
+        // Stiffness seen by the lightest dynamic body of the contact
+        const float hardness_a = info.body_a->get_hardness();
+        const float hardness_b = info.body_b->get_hardness();
+        if( hardness_a > 0.01 && hardness_b > 0.01 && (is_dynamic_a || is_dynamic_b) )
+        {
+            const float equivalent_hardness = 1/( (1/hardness_a) + (1/hardness_b) );
+            float mass = is_dynamic_a ? info.body_a->get_mass() : info.body_b->get_mass();
+            if( is_dynamic_a && is_dynamic_b ) mass = std::min(mass, info.body_b->get_mass());
+            if( mass > 0.0 ) m_max_stiffness_to_mass_ratio = std::max(m_max_stiffness_to_mass_ratio, equivalent_hardness / mass);
+        }
+
+        uint8_t color = BLOCKING_COLLISION_MAX_COLOR;
+        for( uint8_t c = 0; c < BLOCKING_COLLISION_MAX_COLOR; c++ )
+        {
+            if( !(used_colors & (uint64_t(1) << c)) )
+            {
+                color = c;
+                break;
+            }
+        }
+
+        if( color < BLOCKING_COLLISION_MAX_COLOR )
         {
-            // Convert to static rigid body
-            DotStaticRigidBody* const body_a = info.body_a;
-            DotStaticRigidBody* const body_b = info.body_b;
+            if(mask_a) *mask_a |= uint64_t(1) << color;
+            if(mask_b) *mask_b |= uint64_t(1) << color;
+        }
+        m_collision_colors[i] = color;
+        color_sizes[color] += 1;
+    }
+
+    // Counting sort of the contacts by color
+    size_t nbr_color = 0;
+    for( size_t c = 0; c < BLOCKING_COLLISION_MAX_COLOR; c++ )
+    {
+        if( color_sizes[c] > 0 ) nbr_color = c + 1;
+    }
+    m_color_offsets.resize(nbr_color + 2);
+    m_color_offsets[0] = 0;
+    for( size_t c = 0; c < nbr_color; c++ )
+    {
+        m_color_offsets[c+1] = m_color_offsets[c] + color_sizes[c];
+    }
+    m_color_offsets[nbr_color+1] = m_color_offsets[nbr_color] + color_sizes[BLOCKING_COLLISION_MAX_COLOR];
+
+    size_t insert_positions[BLOCKING_COLLISION_MAX_COLOR + 1];
+    std::memcpy(insert_positions, m_color_offsets.data(), (nbr_color + 1)*sizeof(size_t));
+    m_colored_collision_ids.resize(nbr_collision);
+    for( size_t i = 0; i < nbr_collision; i++ )
+    {
+        const uint8_t color = m_collision_colors[i];
+        const size_t color_slot = color < BLOCKING_COLLISION_MAX_COLOR ? color : nbr_color;
+        m_colored_collision_ids[insert_positions[color_slot]] = i;
+        insert_positions[color_slot] += 1;
+    }
+}
 
-            // Compute deformation
-            const float size_a = body_a->get_size();
-            const float size_b = body_b->get_size();
-            const Float2d pos_a = body_a->get_position();
-            const Float2d pos_b = body_b->get_position();
-            const Float2d speed_a = body_a->get_speed();
-            const Float2d speed_b = body_b->get_speed();
+void DotBlockingCollisionEffect::apply_multithread_function(const DotThreadTask& task)
+{
+    const size_t start = m_apply_batch_offset + task.id_start;
+    const size_t end_excluded = start + task.id_size;
+    for(size_t i = start; i < end_excluded; i++)
+    {
+        apply_collision(m_collision_bodies_buffer[m_colored_collision_ids[i]]);
+    }
+}
 
-            const Float2d diff_a2b = pos_b - pos_a;
-            const Float2d diff_deriv_a2b = speed_b - speed_a;
+void DotBlockingCollisionEffect::apply_collision(const BlockingCollisionInfo& info)
+{
+    // Convert to static rigid body
+    DotStaticRigidBody* const body_a = info.body_a;
+    DotStaticRigidBody* const body_b = info.body_b;
 
-            const float critical_dist = size_a + size_b;
-            const float dist = diff_a2b.norm();
+    // Compute deformation along the contact normal
+    const Float2d speed_a = body_a->get_speed();
+    const Float2d speed_b = body_b->get_speed();
+    const Float2d diff_deriv_a2b = speed_b - speed_a;
 
-            if( dist > critical_dist ) return;
+    Float2d dir_a2b;
+    const float contact_dist = DotBodyInterface::getContact(body_a, body_b, dir_a2b);
 
-            const Float2d dir_a2b = diff_a2b/dist;
-            const float dist_deriv = Float2d::dot_product(diff_deriv_a2b, dir_a2b);
+    if( contact_dist > 0.0 ) return;
 
-            const float delta_dist = critical_dist - dist ;
-            const float delta_dist_deriv = -dist_deriv;
+    const float dist_deriv = Float2d::dot_product(diff_deriv_a2b, dir_a2b);
 
-            const Float2d a_constraint = dir_a2b * delta_dist;
-            const Float2d a_constraint_deriv = dir_a2b * delta_dist_deriv;
+    const float delta_dist = -contact_dist;
+    const float delta_dist_deriv = -dist_deriv;
 
-            // Compute forces
-            const float hardness_a = body_a->get_hardness();
-            const float hardness_b = body_b->get_hardness();
-            const float equivalent_hardness = (hardness_a > 0.01 && hardness_b > 0.01) ? 1/( (1/hardness_a) + (1/hardness_b) ) : 0.0;
+    const Float2d a_constraint = dir_a2b * delta_dist;
+    const Float2d a_constraint_deriv = dir_a2b * delta_dist_deriv;
 
-            Float2d force_on_a =  -a_constraint * equivalent_hardness;
-            const Float2d force_on_a_deriv = -a_constraint_deriv * equivalent_hardness;
+    // Compute forces
+    const float hardness_a = body_a->get_hardness();
+    const float hardness_b = body_b->get_hardness();
+    const float equivalent_hardness = (hardness_a > 0.01 && hardness_b > 0.01) ? 1/( (1/hardness_a) + (1/hardness_b) ) : 0.0;
 
-            const float damping_a = body_a->get_damping();
-            const float damping_b = body_b->get_damping();
-            const float equivalent_damping = (damping_a > 0.01 && damping_b > 0.01) ? 1/( (1/damping_a) + (1/damping_b) ) : 0.0;
-            force_on_a -= a_constraint_deriv * equivalent_damping;
+    Float2d force_on_a =  -a_constraint * equivalent_hardness;
+    const Float2d force_on_a_deriv = -a_constraint_deriv * equivalent_hardness;
 
-            const Float2d force_on_b = -force_on_a;
-            const Float2d force_on_b_deriv = -force_on_a_deriv;
+    const float damping_a = body_a->get_damping();
+    const float damping_b = body_b->get_damping();
+    const float equivalent_damping = (damping_a > 0.01 && damping_b > 0.01) ? 1/( (1/damping_a) + (1/damping_b) ) : 0.0;
+    force_on_a -= a_constraint_deriv * equivalent_damping;
 
-            body_a->addForce( force_on_a, force_on_a_deriv );
-            body_b->addForce( force_on_b, force_on_b_deriv );
+    const Float2d force_on_b = -force_on_a;
+    const Float2d force_on_b_deriv = -force_on_a_deriv;
 
-        }
-    }
-};
\ No newline at end of file
+    body_a->addForce( force_on_a, force_on_a_deriv );
+    body_b->addForce( force_on_b, force_on_b_deriv );
+}
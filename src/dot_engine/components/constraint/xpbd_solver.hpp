@@ -0,0 +1,234 @@
+#include "../../system_interface.hpp"
+#include "../body/static_rigid_body.hpp"
+#include "../body/dynamic_rigid_body.hpp"
+#include "../force/link.hpp"
+#include <unordered_map>
+
+#pragma once
+
+// Rope length limits and contact non penetration solved as compliant position constraints (XPBD)
+// The solver is a low resolution system, low resolution systems are applied from the last registered
+// so register it before the force systems to have their acceleration in the prediction
+// Ropes given to the solver must not be registered in the engine, contacts replace DotBlockingCollisionEffect
+// Compound parts are integrated by their compound, the solver skips the ropes and contacts that involve one
+class DotXpbdSolver : public DotSystemInterface
+{
+    private:
+    struct Constraint
+    {
+        size_t id_a;
+        size_t id_b;
+        // Rope: dist <= rest_length, contact: dist >= rest_length
+        // Linear contact: rest_length is the surface distance at the start of the tick
+        float rest_length;
+        float compliance;
+        bool is_contact;
+        // Contacts of non circle shapes are linearized along the contact normal of the start of the tick
+        bool is_linear;
+        Float2d normal;
+    };
+
+    std::vector<std::shared_ptr<DotRopeLink>> m_rope_ptrs;
+    std::vector<std::pair<DotStaticRigidBody*, DotStaticRigidBody*>> m_contact_bodies_buffer;
+    bool m_solve_contacts;
+    size_t m_iteration_nbr;
+
+    std::unordered_map<DotStaticRigidBody*, size_t> m_body_ids;
+    std::vector<DotStaticRigidBody*> m_body_ptrs;
+    std::vector<Float2d> m_initial_positions;
+    std::vector<Float2d> m_positions;
+    std::vector<float> m_inverse_masses;
+    std::vector<Constraint> m_constraints;
+    std::vector<float> m_lambdas;
+
+    size_t get_body_id(DotStaticRigidBody* const body_ptr, const float delta_t);
+    Constraint* add_constraint(DotStaticRigidBody* const body_a, DotStaticRigidBody* const body_b, const float rest_length, const float hardness, const bool is_contact, const float delta_t);
+    void prune_ropes();
+    void solve_constraint(const size_t constraint_id, const float delta_t_2);
+
+    public:
+    DotXpbdSolver():
+    m_solve_contacts(true),
+    m_iteration_nbr(8)
+    {}
+
+    // Rope compliance is 1 / hardness, a rope without hardness is rigid
+    void add_rope(std::shared_ptr<DotRopeLink> rope_ptr){ m_rope_ptrs.emplace_back(std::move(rope_ptr)); }
+    size_t get_rope_nbr() const { return m_rope_ptrs.size(); }
+
+    // Solve the contacts of the collision list, with a compliance of 1 / equivalent hardness
+    bool get_solve_contacts() const { return m_solve_contacts; }
+    void set_solve_contacts(const bool value) { m_solve_contacts = value; }
+
+    // Gauss-Seidel iterations over all constraints per tick
+    size_t get_iteration_nbr() const { return m_iteration_nbr; }
+    void set_iteration_nbr(const size_t value) { m_iteration_nbr = value; }
+
+    virtual bool get_collision_filter(DotCollisionFilter& filter) const {
+        filter.body_type_flags = BODY_TYPE_STATIC_RIGID;
+        filter.touching_only = true;
+        return true;
+    }
+
+    virtual void on_collision_list_update(const std::vector<DotCollisionInfo>& collision_infos){
+        m_contact_bodies_buffer.clear();
+        if( !m_solve_contacts ) return;
+        // The collision filter only let the touching pairs of rigid bodies through
+        for( const DotCollisionInfo& info : collision_infos )
+        {
+            m_contact_bodies_buffer.emplace_back(static_cast<DotStaticRigidBody*>(info.body_a), static_cast<DotStaticRigidBody*>(info.body_b));
+        }
+    }
+
+    virtual void apply( const float delta_t );
+};
+
+size_t DotXpbdSolver::get_body_id(DotStaticRigidBody* const body_ptr, const float delta_t)
+{
+    const std::pair<std::unordered_map<DotStaticRigidBody*, size_t>::iterator, bool> insert_result = m_body_ids.emplace(body_ptr, m_body_ptrs.size());
+    if( insert_result.second )
+    {
+        // Prediction of the position at the end of the tick without constraint
+        const Float2d position = body_ptr->get_position();
+        Float2d predicted_position = position;
+        float inverse_mass = 0.0;
+        if( (body_ptr->get_body_type_flags() & BODY_TYPE_DYNAMIC_RIGID) && body_ptr->get_mass() > 0.0 )
+        {
+            const DotDynamicRigidBody* const dynamic_body_ptr = static_cast<DotDynamicRigidBody*>(body_ptr);
+            const float delta_t_2 = delta_t * delta_t;
+            predicted_position += (body_ptr->get_speed() * delta_t) + (dynamic_body_ptr->get_acceleration() * (delta_t_2 / 2)) + (dynamic_body_ptr->get_acceleration_derive() * (delta_t_2 * delta_t / 6));
+            inverse_mass = 1 / body_ptr->get_mass();
+        }
+        m_body_ptrs.push_back(body_ptr);
+        m_initial_positions.push_back(position);
+        m_positions.push_back(predicted_position);
+        m_inverse_masses.push_back(inverse_mass);
+    }
+    return insert_result.first->second;
+}
+
+DotXpbdSolver::Constraint* DotXpbdSolver::add_constraint(DotStaticRigidBody* const body_a, DotStaticRigidBody* const body_b, const float rest_length, const float hardness, const bool is_contact, const float delta_t)
+{
+    if( (body_a->get_body_type_flags() | body_b->get_body_type_flags()) & BODY_TYPE_COMPOUND_PART ) return nullptr;
+
+    Constraint constraint;
+    constraint.id_a = get_body_id(body_a, delta_t);
+    constraint.id_b = get_body_id(body_b, delta_t);
+    if( m_inverse_masses[constraint.id_a] + m_inverse_masses[constraint.id_b] <= 0.0 ) return nullptr;
+
+    constraint.rest_length = rest_length;
+    constraint.compliance = hardness > 0.0 ? 1/hardness : 0.0;
+    constraint.is_contact = is_contact;
+    constraint.is_linear = false;
+    m_constraints.push_back(constraint);
+    return &m_constraints.back();
+}
+
+void DotXpbdSolver::prune_ropes()
+{
+    for(size_t i_p_1 = m_rope_ptrs.size(); i_p_1 > 0; i_p_1--)
+    {
+        const size_t i = i_p_1  - 1;
+        const std::shared_ptr<DotRopeLink>& rope_ptr = m_rope_ptrs[i];
+        if( rope_ptr->get_target_a().expired() || rope_ptr->get_target_b().expired() ) rope_ptr->destroy();
+        if( rope_ptr->is_destroyed() )
+        {
+            std::swap(m_rope_ptrs[i], m_rope_ptrs.back());
+            m_rope_ptrs.pop_back();
+        }
+    }
+}
+
+void DotXpbdSolver::solve_constraint(const size_t constraint_id, const float delta_t_2)
+{
+    const Constraint& constraint = m_constraints[constraint_id];
+
+    // Inequality constraint c >= 0, its gradient on b is gradient_b and -gradient_b on a
+    float c;
+    Float2d gradient_b;
+    if( constraint.is_linear )
+    {
+        const Float2d motion_a2b = (m_positions[constraint.id_b] - m_initial_positions[constraint.id_b]) - (m_positions[constraint.id_a] - m_initial_positions[constraint.id_a]);
+        c = constraint.rest_length + Float2d::dot_product(motion_a2b, constraint.normal);
+        gradient_b = constraint.normal;
+    }
+    else
+    {
+        const Float2d diff_a2b = m_positions[constraint.id_b] - m_positions[constraint.id_a];
+        const float dist = diff_a2b.norm();
+        if( dist <= 0.0 ) return;
+
+        const Float2d dir_a2b = diff_a2b / dist;
+        c = constraint.is_contact ? dist - constraint.rest_length : constraint.rest_length - dist;
+        gradient_b = constraint.is_contact ? dir_a2b : -dir_a2b;
+    }
+
+    const float inverse_mass_a = m_inverse_masses[constraint.id_a];
+    const float inverse_mass_b = m_inverse_masses[constraint.id_b];
+    const float compliance = constraint.compliance / delta_t_2;
+
+    float& lambda = m_lambdas[constraint_id];
+    const float next_lambda = std::max(0.0f, lambda + ((-c - compliance * lambda) / (inverse_mass_a + inverse_mass_b + compliance)));
+    const float delta_lambda = next_lambda - lambda;
+    lambda = next_lambda;
+
+    m_positions[constraint.id_a] -= gradient_b * (inverse_mass_a * delta_lambda);
+    m_positions[constraint.id_b] += gradient_b * (inverse_mass_b * delta_lambda);
+}
+
+void DotXpbdSolver::apply( const float delta_t )
+{
+    prune_ropes();
+    if( delta_t <= 0.0 ) return;
+
+    m_body_ids.clear();
+    m_body_ptrs.clear();
+    m_initial_positions.clear();
+    m_positions.clear();
+    m_inverse_masses.clear();
+    m_constraints.clear();
+
+    for( const std::shared_ptr<DotRopeLink>& rope_ptr : m_rope_ptrs )
+    {
+        add_constraint(rope_ptr->get_target_a().lock().get(), rope_ptr->get_target_b().lock().get(), rope_ptr->get_length(), rope_ptr->get_hardness(), false, delta_t);
+    }
+
+    for( const std::pair<DotStaticRigidBody*, DotStaticRigidBody*>& contact : m_contact_bodies_buffer )
+    {
+        // Same hardness combination as the blocking collision effect, soft bodies do not block
+        const float hardness_a = contact.first->get_hardness();
+        const float hardness_b = contact.second->get_hardness();
+        if( hardness_a <= 0.01 || hardness_b <= 0.01 ) continue;
+        const float equivalent_hardness = 1/( (1/hardness_a) + (1/hardness_b) );
+        if( contact.first->get_shape_type() == SHAPE_CIRCLE && contact.second->get_shape_type() == SHAPE_CIRCLE )
+        {
+            add_constraint(contact.first, contact.second, contact.first->get_size() + contact.second->get_size(), equivalent_hardness, true, delta_t);
+            continue;
+        }
+        Float2d normal;
+        const float distance = DotBodyInterface::getContact(contact.first, contact.second, normal);
+        Constraint* const constraint = add_constraint(contact.first, contact.second, distance, equivalent_hardness, true, delta_t);
+        if( !constraint ) continue;
+        constraint->is_linear = true;
+        constraint->normal = normal;
+    }
+
+    const size_t nbr_constraint = m_constraints.size();
+    m_lambdas.assign(nbr_constraint, 0.0);
+
+    const float delta_t_2 = delta_t * delta_t;
+    for( size_t iteration = 0; iteration < m_iteration_nbr; iteration++ )
+    {
+        for( size_t i = 0; i < nbr_constraint; i++ ) solve_constraint(i, delta_t_2);
+    }
+
+    // Constrained bodies move straight to the solved position, the accumulated acceleration and its derivative are already in it
+    const size_t nbr_body = m_body_ptrs.size();
+    for( size_t i = 0; i < nbr_body; i++ )
+    {
+        if( m_inverse_masses[i] <= 0.0 ) continue;
+        DotDynamicRigidBody* const body_ptr = static_cast<DotDynamicRigidBody*>(m_body_ptrs[i]);
+        body_ptr->set_speed((m_positions[i] - m_initial_positions[i]) / delta_t);
+        body_ptr->addForce(-body_ptr->get_acceleration() * body_ptr->get_mass(), -body_ptr->get_acceleration_derive() * body_ptr->get_mass());
+    }
+}
@@ -0,0 +1,226 @@
+#include "../../system_interface.hpp"
+#include "../body/static_rigid_body.hpp"
+#include "../body/dynamic_rigid_body.hpp"
+#include "./link.hpp"
+#include <unordered_map>
+#include <limits>
+
+#pragma once
+
+constexpr size_t IMPLICIT_SPRING_NETWORK_STATIC_BODY = std::numeric_limits<size_t>::max();
+
+// Spring links solved together with backward Euler, stable with one step per tick whatever the stiffness
+// Links given to the network must not be registered in the engine, the network is registered as a low resolution system
+class DotImplicitSpringNetwork : public DotSystemInterface
+{
+    private:
+    struct LinkState
+    {
+        size_t id_a;
+        size_t id_b;
+        // h*h*stiffness + h*damping, symmetric 2x2 matrix
+        float a_xx;
+        float a_xy;
+        float a_yy;
+    };
+
+    std::vector<std::shared_ptr<DotSpringLink>> m_link_ptrs;
+
+    // Dynamic bodies of the links, the unknowns of the solve are their speed changes
+    std::unordered_map<DotStaticRigidBody*, size_t> m_body_ids;
+    std::vector<DotStaticRigidBody*> m_body_ptrs;
+    std::vector<float> m_masses;
+    std::vector<LinkState> m_link_states;
+
+    // Conjugate gradient buffers
+    std::vector<Float2d> m_delta_speeds;
+    std::vector<Float2d> m_residuals;
+    std::vector<Float2d> m_directions;
+    std::vector<Float2d> m_products;
+
+    size_t m_max_iteration;
+    float m_tolerance;
+    size_t m_last_iteration_nbr;
+
+    size_t get_body_id(DotStaticRigidBody* const body_ptr);
+    void prune_links();
+    void multiply(const std::vector<Float2d>& vector, std::vector<Float2d>& result) const;
+
+    static Float2d multiply(const LinkState& state, const Float2d& vector) {
+        return Float2d(state.a_xx*vector.x() + state.a_xy*vector.y(), state.a_xy*vector.x() + state.a_yy*vector.y());
+    }
+
+    public:
+    DotImplicitSpringNetwork():
+    m_max_iteration(32),
+    m_tolerance(1e-4),
+    m_last_iteration_nbr(0)
+    {}
+
+    void add_link(std::shared_ptr<DotSpringLink> link_ptr){ m_link_ptrs.emplace_back(std::move(link_ptr)); }
+    size_t get_link_nbr() const { return m_link_ptrs.size(); }
+
+    // Maximum number of conjugate gradient iterations per tick
+    size_t get_max_iteration() const { return m_max_iteration; }
+    void set_max_iteration(const size_t value) { m_max_iteration = value; }
+
+    // Residual norm at which the solve stops, relative to the right hand side norm
+    float get_tolerance() const { return m_tolerance; }
+    void set_tolerance(const float value) { m_tolerance = value; }
+
+    // Number of conjugate gradient iterations of the last apply
+    size_t get_last_iteration_nbr() const { return m_last_iteration_nbr; }
+
+    virtual void declare_access(DotSystemAccess& access) const {
+        for( const std::shared_ptr<DotSpringLink>& link_ptr : m_link_ptrs )
+        {
+            link_ptr->declare_access(access);
+        }
+    }
+
+    virtual void apply( const float delta_t );
+};
+
+size_t DotImplicitSpringNetwork::get_body_id(DotStaticRigidBody* const body_ptr)
+{
+    // Static bodies do not move, their speed is known
+    if( !dynamic_cast<DotDynamicRigidBody*>(body_ptr) || body_ptr->get_mass() <= 0.0 ) return IMPLICIT_SPRING_NETWORK_STATIC_BODY;
+
+    const std::pair<std::unordered_map<DotStaticRigidBody*, size_t>::iterator, bool> insert_result = m_body_ids.emplace(body_ptr, m_body_ptrs.size());
+    if( insert_result.second )
+    {
+        m_body_ptrs.push_back(body_ptr);
+        m_masses.push_back(body_ptr->get_mass());
+    }
+    return insert_result.first->second;
+}
+
+void DotImplicitSpringNetwork::prune_links()
+{
+    for(size_t i_p_1 = m_link_ptrs.size(); i_p_1 > 0; i_p_1--)
+    {
+        const size_t i = i_p_1  - 1;
+        const std::shared_ptr<DotSpringLink>& link_ptr = m_link_ptrs[i];
+        if( link_ptr->get_target_a().expired() || link_ptr->get_target_b().expired() ) link_ptr->destroy();
+        if( link_ptr->is_destroyed() )
+        {
+            std::swap(m_link_ptrs[i], m_link_ptrs.back());
+            m_link_ptrs.pop_back();
+        }
+    }
+}
+
+void DotImplicitSpringNetwork::multiply(const std::vector<Float2d>& vector, std::vector<Float2d>& result) const
+{
+    // (M + h*h*K + h*B) * vector, links add their matrix on the relative speed of their bodies
+    const size_t nbr_body = m_body_ptrs.size();
+    for( size_t i = 0; i < nbr_body; i++ ) result[i] = vector[i] * m_masses[i];
+
+    for( const LinkState& state : m_link_states )
+    {
+        const Float2d vector_a = state.id_a != IMPLICIT_SPRING_NETWORK_STATIC_BODY ? vector[state.id_a] : Float2d();
+        const Float2d vector_b = state.id_b != IMPLICIT_SPRING_NETWORK_STATIC_BODY ? vector[state.id_b] : Float2d();
+        const Float2d product = multiply(state, vector_a - vector_b);
+        if( state.id_a != IMPLICIT_SPRING_NETWORK_STATIC_BODY ) result[state.id_a] += product;
+        if( state.id_b != IMPLICIT_SPRING_NETWORK_STATIC_BODY ) result[state.id_b] -= product;
+    }
+}
+
+void DotImplicitSpringNetwork::apply( const float delta_t )
+{
+    prune_links();
+    m_last_iteration_nbr = 0;
+    if( m_link_ptrs.empty() || delta_t <= 0.0 ) return;
+
+    const float h = delta_t;
+    const float h_2 = h * h;
+
+    m_body_ids.clear();
+    m_body_ptrs.clear();
+    m_masses.clear();
+    m_link_states.clear();
+    m_residuals.clear();
+
+    // Linearise the links, the right hand side is h*(f + h*K*v)
+    for( const std::shared_ptr<DotSpringLink>& link_ptr : m_link_ptrs )
+    {
+        const std::shared_ptr<DotStaticRigidBody> target_ptr_a = link_ptr->get_target_a().lock();
+        const std::shared_ptr<DotStaticRigidBody> target_ptr_b = link_ptr->get_target_b().lock();
+
+        LinkState state;
+        state.id_a = get_body_id(target_ptr_a.get());
+        state.id_b = get_body_id(target_ptr_b.get());
+        if( state.id_a == IMPLICIT_SPRING_NETWORK_STATIC_BODY && state.id_b == IMPLICIT_SPRING_NETWORK_STATIC_BODY ) continue;
+        m_residuals.resize(m_body_ptrs.size());
+
+        const Float2d diff_a2b = target_ptr_b->get_position() - target_ptr_a->get_position();
+        const Float2d diff_deriv_a2b = target_ptr_b->get_speed() - target_ptr_a->get_speed();
+        const float dist = diff_a2b.norm();
+        if( dist <= 0.0 ) continue;
+        const Float2d dir_a2b = diff_a2b/dist;
+
+        const float k = link_ptr->get_hardness();
+        const float b = link_ptr->get_damping();
+        const float length = link_ptr->get_length();
+
+        const Float2d force_on_a = dir_a2b * ( ((dist - length) * k) + (Float2d::dot_product(diff_deriv_a2b, dir_a2b) * b) );
+
+        // Stiffness along the link, plus the transverse part when stretched, a compressed link keep only the axial part to stay definite
+        const float k_transverse = dist > length ? k * (1 - (length/dist)) : 0.0;
+        const float k_axial = k - k_transverse;
+        const float dxx = dir_a2b.x() * dir_a2b.x();
+        const float dxy = dir_a2b.x() * dir_a2b.y();
+        const float dyy = dir_a2b.y() * dir_a2b.y();
+        const float stiffness_xx = k_axial * dxx + k_transverse;
+        const float stiffness_xy = k_axial * dxy;
+        const float stiffness_yy = k_axial * dyy + k_transverse;
+
+        const Float2d stiffness_on_speed = Float2d(stiffness_xx*diff_deriv_a2b.x() + stiffness_xy*diff_deriv_a2b.y(), stiffness_xy*diff_deriv_a2b.x() + stiffness_yy*diff_deriv_a2b.y());
+        const Float2d rhs_a = (force_on_a * h) + (stiffness_on_speed * h_2);
+        if( state.id_a != IMPLICIT_SPRING_NETWORK_STATIC_BODY ) m_residuals[state.id_a] += rhs_a;
+        if( state.id_b != IMPLICIT_SPRING_NETWORK_STATIC_BODY ) m_residuals[state.id_b] -= rhs_a;
+
+        state.a_xx = h_2*stiffness_xx + h*b*dxx;
+        state.a_xy = h_2*stiffness_xy + h*b*dxy;
+        state.a_yy = h_2*stiffness_yy + h*b*dyy;
+        m_link_states.push_back(state);
+    }
+
+    // Conjugate gradient on (M + h*h*K + h*B) * delta_v = rhs, the matrix is symmetric positive definite
+    const size_t nbr_body = m_body_ptrs.size();
+    m_delta_speeds.assign(nbr_body, Float2d());
+    m_directions.assign(m_residuals.begin(), m_residuals.end());
+    m_products.resize(nbr_body);
+
+    float residual_norm2 = 0.0;
+    for( size_t i = 0; i < nbr_body; i++ ) residual_norm2 += m_residuals[i].norm2();
+    const float stop_norm2 = residual_norm2 * m_tolerance * m_tolerance;
+
+    while( m_last_iteration_nbr < m_max_iteration && residual_norm2 > stop_norm2 && residual_norm2 > 0.0 )
+    {
+        multiply(m_directions, m_products);
+        float direction_product = 0.0;
+        for( size_t i = 0; i < nbr_body; i++ ) direction_product += Float2d::dot_product(m_directions[i], m_products[i]);
+        if( direction_product <= 0.0 ) break;
+
+        const float alpha = residual_norm2 / direction_product;
+        float next_residual_norm2 = 0.0;
+        for( size_t i = 0; i < nbr_body; i++ )
+        {
+            m_delta_speeds[i] += m_directions[i] * alpha;
+            m_residuals[i] -= m_products[i] * alpha;
+            next_residual_norm2 += m_residuals[i].norm2();
+        }
+
+        const float beta = next_residual_norm2 / residual_norm2;
+        for( size_t i = 0; i < nbr_body; i++ ) m_directions[i] = m_residuals[i] + (m_directions[i] * beta);
+        residual_norm2 = next_residual_norm2;
+        m_last_iteration_nbr += 1;
+    }
+
+    // Constant force giving the solved speed change over the tick
+    for( size_t i = 0; i < nbr_body; i++ )
+    {
+        m_body_ptrs[i]->addForce(m_delta_speeds[i] * (m_masses[i] / h));
+    }
+}
@@ -1,13 +1,17 @@
 #include "../../system_interface.hpp"
+#include "../../contact_adjacency.hpp"
 #include "../body/static_rigid_body.hpp"
+#include <unordered_set>
 
 #pragma once
 
+// Walls are searched in the contacts of the jumper, the force request a contact margin of the distance threshold on it
 class DotJumpingForce : public DotSystemInterface
 {
     private:
     std::weak_ptr<DotStaticRigidBody> m_jumper_ptr;
     std::vector<std::weak_ptr<DotStaticRigidBody>> m_wall_ptrs;
+    std::unordered_set<const DotBodyInterface*> m_wall_set;
     Float2d m_value;
     float m_initial_value;
     float m_degradation_rate;
@@ -15,26 +19,75 @@ class DotJumpingForce : public DotSystemInterface
     bool m_is_active;
     bool m_has_jump;
 
+    // Body holding the contact margin request of the force
+    std::weak_ptr<DotStaticRigidBody> m_margin_body_ptr;
+
+    void release_contact_margin() {
+        if( const std::shared_ptr<DotStaticRigidBody> body_ptr = m_margin_body_ptr.lock()) body_ptr->release_contact_margin(this);
+        m_margin_body_ptr.reset();
+    }
+
+    // Walls closer than the threshold must be in the contacts of the jumper
+    void update_contact_margin() {
+        release_contact_margin();
+        if( const std::shared_ptr<DotStaticRigidBody> jumper_ptr = m_jumper_ptr.lock())
+        {
+            jumper_ptr->request_contact_margin(this, m_distance_threshold);
+            m_margin_body_ptr = jumper_ptr;
+        }
+    }
+
     public:
-    DotJumpingForce():m_is_active(false), m_has_jump(false) {}
+    DotJumpingForce():m_distance_threshold(0.0), m_is_active(false), m_has_jump(false) {}
 
     float get_initial_value() const { return m_initial_value; }
     void set_initial_value(const float value) {m_initial_value = value;}
 
     std::weak_ptr<DotStaticRigidBody> get_jumper() const {return m_jumper_ptr;}
-    void set_jumper(const std::weak_ptr<DotStaticRigidBody>& jumper) { m_jumper_ptr = jumper;}
+    void set_jumper(const std::weak_ptr<DotStaticRigidBody>& jumper) { m_jumper_ptr = jumper; update_contact_margin();}
 
-    void add_wall(const std::weak_ptr<DotStaticRigidBody>& wall) { m_wall_ptrs.push_back(wall); }
+    void add_wall(const std::weak_ptr<DotStaticRigidBody>& wall) {
+        m_wall_ptrs.push_back(wall);
+        if( const std::shared_ptr<DotStaticRigidBody> wall_ptr = wall.lock()) m_wall_set.insert(wall_ptr.get());
+    }
 
     float get_degradation_rate() const {return m_degradation_rate;}
     void set_degradation_rate(const float value) { m_degradation_rate = value;}
 
     float get_distance_threshold() const {return m_distance_threshold;}
-    void set_distance_threshold(const float value) { m_distance_threshold = value;}
+    void set_distance_threshold(const float value) { m_distance_threshold = value; update_contact_margin();}
 
     bool get_is_active() const {return m_is_active;}
     void set_is_active(const bool value) { m_is_active = value;}
 
+    virtual void declare_access(DotSystemAccess& access) const {
+        if( const std::shared_ptr<DotStaticRigidBody> jumper_ptr = m_jumper_ptr.lock()) access.write_bodies.push_back(jumper_ptr.get());
+        for(const std::weak_ptr<DotStaticRigidBody>& wall : m_wall_ptrs)
+        {
+            if( const std::shared_ptr<DotStaticRigidBody> wall_ptr = wall.lock()) access.read_bodies.push_back(wall_ptr.get());
+        }
+    }
+
+    virtual void on_unregister() {
+        release_contact_margin();
+    }
+
+    // Forget the walls out of the engine
+    virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
+        m_wall_set.clear();
+        for(size_t i_p_1 = m_wall_ptrs.size(); i_p_1 > 0; i_p_1--)
+        {
+            const size_t i = i_p_1 -1;
+            const std::shared_ptr<DotStaticRigidBody> wall_ptr = m_wall_ptrs[i].lock();
+            if( !wall_ptr || wall_ptr->is_destroyed() )
+            {
+                std::swap(m_wall_ptrs[i], m_wall_ptrs.back());
+                m_wall_ptrs.pop_back();
+            }
+            else m_wall_set.insert(wall_ptr.get());
+        }
+    }
+
     virtual void apply( [[maybe_unused]] const float delta_t ) {
         if( m_is_active )
         {
@@ -45,32 +98,25 @@ class DotJumpingForce : public DotSystemInterface
                 return;
             }
 
-            if( ! m_has_jump )
+            if( ! m_has_jump && m_contact_adjacency_ptr )
             {
                 Float2d best_dir = Float2d(0.0, 0.0);
                 bool jump_found = false;
                 float best_dist = m_distance_threshold;
 
-                for(size_t i_p_1 = m_wall_ptrs.size(); i_p_1 > 0; i_p_1--)
+                for(const size_t collision_id : m_contact_adjacency_ptr->get_collision_ids(jumper_ptr.get()))
                 {
-                    const size_t i = i_p_1 -1;
-                    const std::shared_ptr<DotStaticRigidBody> wall_ptr = m_wall_ptrs[i].lock();
-                    if( !wall_ptr || wall_ptr->is_destroyed() )
-                    {
-                        std::swap(m_wall_ptrs[i], m_wall_ptrs.back());
-                        m_wall_ptrs.pop_back();
-                    }
-                    else
+                    const DotBodyInterface* const wall_ptr = m_contact_adjacency_ptr->get_other_body(collision_id, jumper_ptr.get());
+                    if( !m_wall_set.count(wall_ptr) ) continue;
+
+                    // Contact normal from the wall to the jumper, the center direction for circles
+                    Float2d w2j_dir;
+                    const float dist = DotBodyInterface::getContact(wall_ptr, jumper_ptr.get(), w2j_dir);
+                    if( dist < best_dist)
                     {
-                        Float2d w2j = jumper_ptr->get_position() - wall_ptr->get_position();
-                        float w2j_norm = w2j.norm();
-                        float dist = w2j_norm - (jumper_ptr->get_size() + wall_ptr->get_size() );
-                        if( dist < best_dist)
-                        {
-                            best_dist = dist;
-                            best_dir = w2j/w2j_norm;
-                            jump_found = true;
-                        }
+                        best_dist = dist;
+                        best_dir = w2j_dir;
+                        jump_found = true;
                     }
                 }
 
@@ -80,7 +126,7 @@ class DotJumpingForce : public DotSystemInterface
                     m_has_jump = true;
                 }
             }
-            else
+            else if( m_has_jump )
             {
                 float value_norm = m_value.norm();
                 float new_value_norm = value_norm - (m_degradation_rate * delta_t);
@@ -1,5 +1,6 @@
 #include "../../system_interface.hpp"
 #include "../body/static_rigid_body.hpp"
+#include "../body/dynamic_rigid_body.hpp"
 
 #pragma once
 
@@ -17,6 +18,11 @@ class DotLinkBase : public DotSystemInterface
     std::weak_ptr<DotStaticRigidBody> get_target_b() const {return m_target_ptr_b;}
     void set_target_b(const std::weak_ptr<DotStaticRigidBody>& target) { m_target_ptr_b = target;}
 
+    virtual void declare_access(DotSystemAccess& access) const {
+        if( const std::shared_ptr<DotStaticRigidBody> target_ptr_a = m_target_ptr_a.lock()) access.write_bodies.push_back(target_ptr_a.get());
+        if( const std::shared_ptr<DotStaticRigidBody> target_ptr_b = m_target_ptr_b.lock()) access.write_bodies.push_back(target_ptr_b.get());
+    }
+
 };
 
 class DotSpingLinkBase : public DotLinkBase
@@ -37,6 +43,18 @@ class DotSpingLinkBase : public DotLinkBase
     float get_damping() const { return m_b; }
     void set_damping(const float value) {m_b = value;}
 
+    // Stiffness seen by the lightest dynamic target
+    virtual float get_max_stiffness_to_mass_ratio() const {
+        float mass = 0.0;
+        for(const std::weak_ptr<DotStaticRigidBody>& target : {m_target_ptr_a, m_target_ptr_b})
+        {
+            const std::shared_ptr<DotStaticRigidBody> target_ptr = target.lock();
+            if( !target_ptr || !dynamic_cast<DotDynamicRigidBody*>(target_ptr.get()) ) continue;
+            if( mass <= 0.0 || target_ptr->get_mass() < mass ) mass = target_ptr->get_mass();
+        }
+        return mass > 0.0 ? m_k / mass : 0.0;
+    }
+
 };
 
 class DotSpringLink : public DotSpingLinkBase
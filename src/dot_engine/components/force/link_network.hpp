@@ -0,0 +1,415 @@
+#include "../../system_interface.hpp"
+#include "../../physic_multithread_helper.hpp"
+#include "../body/static_rigid_body.hpp"
+#include "../body/dynamic_rigid_body.hpp"
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+
+#pragma once
+
+// Ranges smaller than this are computed on the calling thread
+constexpr size_t LINK_NETWORK_MULTITHREAD_MINIMUM_BATCH = 256;
+// Number of color usable by the graph coloring, links that do not fit go in a serial batch
+constexpr size_t LINK_NETWORK_MAX_COLOR = 64;
+
+// Many spring and rope links evaluated together, links are stored as flat arrays sorted by color
+// The network is one system, the links given to it are not DotSystemInterface and must not be registered in the engine
+// Bodies of the links must be registered in the engine, links of destroyed bodies are removed on body list update
+class DotLinkNetwork : public DotSystemInterface
+{
+    private:
+    // Bodies of the links, links refer to them by index
+    std::vector<std::weak_ptr<DotStaticRigidBody>> m_body_weak_ptrs;
+    std::vector<DotStaticRigidBody*> m_body_ptrs;
+    std::unordered_map<const DotStaticRigidBody*, uint32_t> m_body_ids;
+
+    // Links, one array per field
+    std::vector<uint32_t> m_link_body_a;
+    std::vector<uint32_t> m_link_body_b;
+    std::vector<float> m_link_lengths;
+    std::vector<float> m_link_hardnesses;
+    std::vector<float> m_link_dampings;
+    // 1 for a spring, 0 for a rope that only pull
+    std::vector<float> m_link_spring_masks;
+
+    // Body state gathered at the start of apply
+    std::vector<float> m_position_x;
+    std::vector<float> m_position_y;
+    std::vector<float> m_speed_x;
+    std::vector<float> m_speed_y;
+
+    // Force on body a of each link, body b receive the opposite
+    std::vector<float> m_force_x;
+    std::vector<float> m_force_y;
+    std::vector<float> m_force_derivative_x;
+    std::vector<float> m_force_derivative_y;
+
+    // Link ranges by color, no two links of a same color share a dynamic body
+    std::vector<size_t> m_color_offsets;
+    bool m_coloring_changed;
+    float m_max_stiffness_to_mass_ratio;
+
+    std::function<void(const DotThreadTask&)> m_gather_multithread_function;
+    std::function<void(const DotThreadTask&)> m_compute_multithread_function;
+    std::function<void(const DotThreadTask&)> m_scatter_multithread_function;
+    size_t m_scatter_batch_offset;
+
+    uint32_t get_body_id(const std::shared_ptr<DotStaticRigidBody>& body_ptr);
+    void add_link(const std::shared_ptr<DotStaticRigidBody>& body_a, const std::shared_ptr<DotStaticRigidBody>& body_b, const float length, const float hardness, const float damping, const float spring_mask);
+    void remove_destroyed_links();
+    void color_links();
+    void run(const float delta_t, const size_t size, std::function<void(const DotThreadTask&)>& function);
+
+    void gather(const size_t start, const size_t end_excluded);
+    void compute(const size_t start, const size_t end_excluded, const float delta_t);
+    void scatter(const size_t start, const size_t end_excluded);
+
+    public:
+    DotLinkNetwork():
+    m_color_offsets(1, 0),
+    m_coloring_changed(false),
+    m_max_stiffness_to_mass_ratio(0.0),
+    m_gather_multithread_function([this](const DotThreadTask& task){ gather(task.id_start, task.id_start + task.id_size); }),
+    m_compute_multithread_function([this](const DotThreadTask& task){ compute(task.id_start, task.id_start + task.id_size, task.dt); }),
+    m_scatter_multithread_function([this](const DotThreadTask& task){ scatter(m_scatter_batch_offset + task.id_start, m_scatter_batch_offset + task.id_start + task.id_size); }),
+    m_scatter_batch_offset(0)
+    {}
+
+    DotLinkNetwork([[maybe_unused]] const DotLinkNetwork& other):
+    DotLinkNetwork()
+    {}
+
+    virtual ~DotLinkNetwork(){}
+
+    // Same force as DotSpringLink
+    void add_spring(const std::shared_ptr<DotStaticRigidBody>& body_a, const std::shared_ptr<DotStaticRigidBody>& body_b, const float length, const float hardness, const float damping){
+        add_link(body_a, body_b, length, hardness, damping, 1.0);
+    }
+    // Same force as DotRopeLink
+    void add_rope(const std::shared_ptr<DotStaticRigidBody>& body_a, const std::shared_ptr<DotStaticRigidBody>& body_b, const float length, const float hardness, const float damping){
+        add_link(body_a, body_b, length, hardness, damping, 0.0);
+    }
+
+    size_t get_link_nbr() const { return m_link_lengths.size(); }
+    size_t get_color_nbr() const { return m_color_offsets.size() - 1; }
+    void clear();
+
+    virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
+        remove_destroyed_links();
+    }
+
+    virtual float get_max_stiffness_to_mass_ratio() const { return m_max_stiffness_to_mass_ratio; }
+
+    // The network use the multithread helper so it stay exclusive, but its bodies are known
+    virtual bool declare_high_resolution_bodies(DotSystemAccess& access) const {
+        access.write_bodies.insert(access.write_bodies.end(), m_body_ptrs.begin(), m_body_ptrs.end());
+        return true;
+    }
+
+    virtual void apply( const float delta_t );
+};
+
+uint32_t DotLinkNetwork::get_body_id(const std::shared_ptr<DotStaticRigidBody>& body_ptr)
+{
+    const std::pair<std::unordered_map<const DotStaticRigidBody*, uint32_t>::iterator, bool> insert_result = m_body_ids.emplace(body_ptr.get(), uint32_t(m_body_ptrs.size()));
+    if( insert_result.second )
+    {
+        m_body_weak_ptrs.push_back(body_ptr);
+        m_body_ptrs.push_back(body_ptr.get());
+    }
+    return insert_result.first->second;
+}
+
+void DotLinkNetwork::add_link(const std::shared_ptr<DotStaticRigidBody>& body_a, const std::shared_ptr<DotStaticRigidBody>& body_b, const float length, const float hardness, const float damping, const float spring_mask)
+{
+    if( !body_a || !body_b || body_a == body_b ) return;
+    m_link_body_a.push_back(get_body_id(body_a));
+    m_link_body_b.push_back(get_body_id(body_b));
+    m_link_lengths.push_back(length);
+    m_link_hardnesses.push_back(hardness);
+    m_link_dampings.push_back(damping);
+    m_link_spring_masks.push_back(spring_mask);
+    m_coloring_changed = true;
+}
+
+void DotLinkNetwork::clear()
+{
+    m_body_weak_ptrs.clear();
+    m_body_ptrs.clear();
+    m_body_ids.clear();
+    m_link_body_a.clear();
+    m_link_body_b.clear();
+    m_link_lengths.clear();
+    m_link_hardnesses.clear();
+    m_link_dampings.clear();
+    m_link_spring_masks.clear();
+    m_coloring_changed = true;
+}
+
+void DotLinkNetwork::remove_destroyed_links()
+{
+    // Bodies leave the engine only when destroyed, so checking here is enough to never use a freed body
+    const size_t nbr_body = m_body_ptrs.size();
+    std::vector<uint32_t> new_body_ids(nbr_body);
+    size_t nbr_kept_body = 0;
+    for( size_t i = 0; i < nbr_body; i++ )
+    {
+        const bool is_removed = m_body_weak_ptrs[i].expired() || m_body_ptrs[i]->is_destroyed();
+        new_body_ids[i] = is_removed ? UINT32_MAX : uint32_t(nbr_kept_body);
+        if( is_removed ) continue;
+        m_body_weak_ptrs[nbr_kept_body] = m_body_weak_ptrs[i];
+        m_body_ptrs[nbr_kept_body] = m_body_ptrs[i];
+        nbr_kept_body += 1;
+    }
+    if( nbr_kept_body == nbr_body ) return;
+
+    m_body_weak_ptrs.resize(nbr_kept_body);
+    m_body_ptrs.resize(nbr_kept_body);
+    m_body_ids.clear();
+    for( size_t i = 0; i < nbr_kept_body; i++ ) m_body_ids.emplace(m_body_ptrs[i], uint32_t(i));
+
+    const size_t nbr_link = m_link_lengths.size();
+    size_t nbr_kept_link = 0;
+    for( size_t i = 0; i < nbr_link; i++ )
+    {
+        const uint32_t id_a = new_body_ids[m_link_body_a[i]];
+        const uint32_t id_b = new_body_ids[m_link_body_b[i]];
+        if( id_a == UINT32_MAX || id_b == UINT32_MAX ) continue;
+        m_link_body_a[nbr_kept_link] = id_a;
+        m_link_body_b[nbr_kept_link] = id_b;
+        m_link_lengths[nbr_kept_link] = m_link_lengths[i];
+        m_link_hardnesses[nbr_kept_link] = m_link_hardnesses[i];
+        m_link_dampings[nbr_kept_link] = m_link_dampings[i];
+        m_link_spring_masks[nbr_kept_link] = m_link_spring_masks[i];
+        nbr_kept_link += 1;
+    }
+    m_link_body_a.resize(nbr_kept_link);
+    m_link_body_b.resize(nbr_kept_link);
+    m_link_lengths.resize(nbr_kept_link);
+    m_link_hardnesses.resize(nbr_kept_link);
+    m_link_dampings.resize(nbr_kept_link);
+    m_link_spring_masks.resize(nbr_kept_link);
+    m_coloring_changed = true;
+}
+
+void DotLinkNetwork::color_links()
+{
+    // Greedy coloring, a link take the first color not used by one of its bodies
+    // Static bodies ignore forces, so they do not constrain the coloring
+    const size_t nbr_body = m_body_ptrs.size();
+    const size_t nbr_link = m_link_lengths.size();
+    std::vector<uint64_t> body_color_masks(nbr_body, 0);
+    std::vector<uint8_t> body_is_dynamic(nbr_body);
+    std::vector<uint8_t> link_colors(nbr_link);
+    m_max_stiffness_to_mass_ratio = 0.0;
+
+    for( size_t i = 0; i < nbr_body; i++ )
+    {
+        body_is_dynamic[i] = dynamic_cast<DotDynamicRigidBody*>(m_body_ptrs[i]) != nullptr;
+    }
+
+    size_t color_sizes[LINK_NETWORK_MAX_COLOR + 1] = {};
+    for( size_t i = 0; i < nbr_link; i++ )
+    {
+        const uint32_t id_a = m_link_body_a[i];
+        const uint32_t id_b = m_link_body_b[i];
+        uint64_t* const mask_a = body_is_dynamic[id_a] ? &body_color_masks[id_a] : nullptr;
+        uint64_t* const mask_b = body_is_dynamic[id_b] ? &body_color_masks[id_b] : nullptr;
+        const uint64_t used_colors = (mask_a ? *mask_a : 0) | (mask_b ? *mask_b : 0);
+
+        // Stiffness seen by the lightest dynamic body of the link
+        float mass = 0.0;
+        if( mask_a ) mass = m_body_ptrs[id_a]->get_mass();
+        if( mask_b && (mass <= 0.0 || m_body_ptrs[id_b]->get_mass() < mass) ) mass = m_body_ptrs[id_b]->get_mass();
+        if( mass > 0.0 ) m_max_stiffness_to_mass_ratio = std::max(m_max_stiffness_to_mass_ratio, m_link_hardnesses[i] / mass);
+
+        uint8_t color = LINK_NETWORK_MAX_COLOR;
+        for( uint8_t c = 0; c < LINK_NETWORK_MAX_COLOR; c++ )
+        {
+            if( !(used_colors & (uint64_t(1) << c)) )
+            {
+                color = c;
+                break;
+            }
+        }
+
+        if( color < LINK_NETWORK_MAX_COLOR )
+        {
+            if(mask_a) *mask_a |= uint64_t(1) << color;
+            if(mask_b) *mask_b |= uint64_t(1) << color;
+        }
+        link_colors[i] = color;
+        color_sizes[color] += 1;
+    }
+
+    // Counting sort of the links by color, the link arrays are reordered so every color is a contiguous range
+    size_t nbr_color = 0;
+    for( size_t c = 0; c < LINK_NETWORK_MAX_COLOR; c++ )
+    {
+        if( color_sizes[c] > 0 ) nbr_color = c + 1;
+    }
+    m_color_offsets.resize(nbr_color + 2);
+    m_color_offsets[0] = 0;
+    for( size_t c = 0; c < nbr_color; c++ )
+    {
+        m_color_offsets[c+1] = m_color_offsets[c] + color_sizes[c];
+    }
+    m_color_offsets[nbr_color+1] = m_color_offsets[nbr_color] + color_sizes[LINK_NETWORK_MAX_COLOR];
+
+    size_t insert_positions[LINK_NETWORK_MAX_COLOR + 1];
+    std::memcpy(insert_positions, m_color_offsets.data(), (nbr_color + 1)*sizeof(size_t));
+    std::vector<size_t> sorted_positions(nbr_link);
+    for( size_t i = 0; i < nbr_link; i++ )
+    {
+        const uint8_t color = link_colors[i];
+        const size_t color_slot = color < LINK_NETWORK_MAX_COLOR ? color : nbr_color;
+        sorted_positions[i] = insert_positions[color_slot];
+        insert_positions[color_slot] += 1;
+    }
+
+    const auto reorder = [&sorted_positions, nbr_link](auto& values)
+    {
+        std::remove_reference_t<decltype(values)> sorted_values(nbr_link);
+        for( size_t i = 0; i < nbr_link; i++ ) sorted_values[sorted_positions[i]] = values[i];
+        values.swap(sorted_values);
+    };
+    reorder(m_link_body_a);
+    reorder(m_link_body_b);
+    reorder(m_link_lengths);
+    reorder(m_link_hardnesses);
+    reorder(m_link_dampings);
+    reorder(m_link_spring_masks);
+
+    m_force_x.resize(nbr_link);
+    m_force_y.resize(nbr_link);
+    m_force_derivative_x.resize(nbr_link);
+    m_force_derivative_y.resize(nbr_link);
+    m_position_x.resize(nbr_body);
+    m_position_y.resize(nbr_body);
+    m_speed_x.resize(nbr_body);
+    m_speed_y.resize(nbr_body);
+    m_coloring_changed = false;
+}
+
+void DotLinkNetwork::run(const float delta_t, const size_t size, std::function<void(const DotThreadTask&)>& function)
+{
+    if( size < LINK_NETWORK_MULTITHREAD_MINIMUM_BATCH || !m_multi_thread_helper_ptr )
+    {
+        DotThreadTask task;
+        task.id_start = 0;
+        task.id_size = size;
+        task.dt = delta_t;
+        task.high_resolution_dt = 0.0;
+        task.task_id = DotThreadTaskId::CUSTOM;
+        function(task);
+    }
+    else
+    {
+        m_multi_thread_helper_ptr->custom_function(delta_t, size, &function);
+    }
+}
+
+void DotLinkNetwork::gather(const size_t start, const size_t end_excluded)
+{
+    for( size_t i = start; i < end_excluded; i++ )
+    {
+        const Float2d position = m_body_ptrs[i]->get_position();
+        const Float2d speed = m_body_ptrs[i]->get_speed();
+        m_position_x[i] = position.x();
+        m_position_y[i] = position.y();
+        m_speed_x[i] = speed.x();
+        m_speed_y[i] = speed.y();
+    }
+}
+
+void DotLinkNetwork::compute(const size_t start, const size_t end_excluded, const float delta_t)
+{
+    // Branch free so the compiler can vectorize it, the rope slack is a mask on the magnitude
+    const uint32_t* const body_a = m_link_body_a.data();
+    const uint32_t* const body_b = m_link_body_b.data();
+    const float* const lengths = m_link_lengths.data();
+    const float* const hardnesses = m_link_hardnesses.data();
+    const float* const dampings = m_link_dampings.data();
+    const float* const spring_masks = m_link_spring_masks.data();
+    const float* const position_x = m_position_x.data();
+    const float* const position_y = m_position_y.data();
+    const float* const speed_x = m_speed_x.data();
+    const float* const speed_y = m_speed_y.data();
+    float* const force_x = m_force_x.data();
+    float* const force_y = m_force_y.data();
+    float* const force_derivative_x = m_force_derivative_x.data();
+    float* const force_derivative_y = m_force_derivative_y.data();
+
+    for( size_t i = start; i < end_excluded; i++ )
+    {
+        const uint32_t id_a = body_a[i];
+        const uint32_t id_b = body_b[i];
+        const float diff_x = position_x[id_b] - position_x[id_a];
+        const float diff_y = position_y[id_b] - position_y[id_a];
+        const float diff_deriv_x = speed_x[id_b] - speed_x[id_a];
+        const float diff_deriv_y = speed_y[id_b] - speed_y[id_a];
+
+        const float dist = sqrtf((diff_x*diff_x) + (diff_y*diff_y));
+        const float inverse_dist = dist > 0.0f ? 1.0f/dist : 0.0f;
+        const float dir_x = diff_x * inverse_dist;
+        const float dir_y = diff_y * inverse_dist;
+        const float dist_deriv = (diff_deriv_x*dir_x) + (diff_deriv_y*dir_y);
+
+        const float k = hardnesses[i];
+        const float spring_mask = spring_masks[i];
+        const float delta_dist = dist - lengths[i];
+        const float active = spring_mask + ((1.0f - spring_mask) * (delta_dist > 0.0f ? 1.0f : 0.0f));
+
+        const float magnitude = delta_dist * k;
+        const float magnitude_deriv = ((spring_mask*magnitude*delta_t) + dist_deriv) * k;
+        const float magnitude_damping = dist_deriv * dampings[i];
+
+        const float total_magnitude = (magnitude + magnitude_damping) * active;
+        const float total_magnitude_deriv = magnitude_deriv * active;
+        force_x[i] = dir_x * total_magnitude;
+        force_y[i] = dir_y * total_magnitude;
+        force_derivative_x[i] = dir_x * total_magnitude_deriv;
+        force_derivative_y[i] = dir_y * total_magnitude_deriv;
+    }
+}
+
+void DotLinkNetwork::scatter(const size_t start, const size_t end_excluded)
+{
+    for( size_t i = start; i < end_excluded; i++ )
+    {
+        const Float2d force_on_a = Float2d(m_force_x[i], m_force_y[i]);
+        const Float2d force_on_a_deriv = Float2d(m_force_derivative_x[i], m_force_derivative_y[i]);
+        m_body_ptrs[m_link_body_a[i]]->addForce(force_on_a, force_on_a_deriv);
+        m_body_ptrs[m_link_body_b[i]]->addForce(-force_on_a, -force_on_a_deriv);
+    }
+}
+
+void DotLinkNetwork::apply( const float delta_t )
+{
+    if( m_coloring_changed ) color_links();
+    const size_t nbr_link = m_link_lengths.size();
+    if( nbr_link == 0 ) return;
+
+    run(delta_t, m_body_ptrs.size(), m_gather_multithread_function);
+    run(delta_t, nbr_link, m_compute_multithread_function);
+
+    const size_t nbr_color = m_color_offsets.size() - 1;
+    for( size_t color = 0; color < nbr_color; color++ )
+    {
+        const size_t batch_start = m_color_offsets[color];
+        const size_t batch_size = m_color_offsets[color+1] - batch_start;
+
+        // Last batch hold the links that could not be colored
+        const bool is_serial_batch = color == (nbr_color - 1);
+        if( is_serial_batch || batch_size < LINK_NETWORK_MULTITHREAD_MINIMUM_BATCH || !m_multi_thread_helper_ptr )
+        {
+            scatter(batch_start, batch_start + batch_size);
+        }
+        else
+        {
+            m_scatter_batch_offset = batch_start;
+            m_multi_thread_helper_ptr->custom_function(delta_t, batch_size, &m_scatter_multithread_function);
+        }
+    }
+}
@@ -1,74 +1,113 @@
 #include "../../system_interface.hpp"
+#include "../../contact_adjacency.hpp"
 #include "../body/static_rigid_body.hpp"
+#include <unordered_map>
 
 #pragma once
 
+// Floors are searched in the contacts of the runner, the force request a contact margin of the distance threshold on it
 class DotRunningForce : public DotSystemInterface
 {
     protected:
+    struct Floor
+    {
+        DotStaticRigidBody* floor_ptr;
+        float friction;
+    };
+
     std::weak_ptr<DotStaticRigidBody> m_runner_ptr;
     std::vector<std::weak_ptr<DotStaticRigidBody>> m_floor_ptrs;
     std::vector<float> m_friction;
+    // Floors in the engine by body, the pointers are valid while the floor is in the engine
+    std::unordered_map<const DotBodyInterface*, Floor> m_floor_map;
     float m_running_value;
     float m_distance_threshold;
     int8_t m_dir;
 
+    // Body holding the contact margin request of the force
+    std::weak_ptr<DotStaticRigidBody> m_margin_body_ptr;
+
+    void release_contact_margin() {
+        if( const std::shared_ptr<DotStaticRigidBody> body_ptr = m_margin_body_ptr.lock()) body_ptr->release_contact_margin(this);
+        m_margin_body_ptr.reset();
+    }
+
+    // Floors closer than the threshold must be in the contacts of the runner
+    void update_contact_margin() {
+        release_contact_margin();
+        if( const std::shared_ptr<DotStaticRigidBody> runner_ptr = m_runner_ptr.lock())
+        {
+            runner_ptr->request_contact_margin(this, m_distance_threshold);
+            m_margin_body_ptr = runner_ptr;
+        }
+    }
+
+    // Nearest floor in contact closer than the distance threshold, false when there is none
+    bool find_floor(const DotStaticRigidBody* const runner_ptr, Float2d& best_dir, DotStaticRigidBody*& best_floor, float& best_friction) const;
+
     public:
-    DotRunningForce():m_running_value(0.0),m_dir(0){}
+    DotRunningForce():m_running_value(0.0),m_distance_threshold(0.0),m_dir(0){}
 
     float get_running_value() const { return m_running_value; }
     void set_running_value(const float value) {m_running_value = value;}
 
     float get_distance_threshold() const { return m_distance_threshold; }
-    void set_distance_threshold(const float value) {m_distance_threshold = value;}
+    void set_distance_threshold(const float value) {m_distance_threshold = value; update_contact_margin();}
 
     int8_t get_direction() const { return m_dir; }
     void set_direction(const int8_t value) {m_dir = value;}
 
     std::weak_ptr<DotStaticRigidBody> get_runner() const {return m_runner_ptr;}
-    void set_runner(const std::weak_ptr<DotStaticRigidBody>& jumper) { m_runner_ptr = jumper;}
+    void set_runner(const std::weak_ptr<DotStaticRigidBody>& jumper) { m_runner_ptr = jumper; update_contact_margin();}
+
+    void add_floor(const std::weak_ptr<DotStaticRigidBody>& floor, float friction = 1.0) {
+        m_floor_ptrs.push_back(floor);
+        m_friction.push_back(friction);
+        if( const std::shared_ptr<DotStaticRigidBody> floor_ptr = floor.lock()) m_floor_map[floor_ptr.get()] = {floor_ptr.get(), friction};
+    }
+
+    // The floor get the reaction force, it is written too
+    virtual void declare_access(DotSystemAccess& access) const {
+        if( const std::shared_ptr<DotStaticRigidBody> runner_ptr = m_runner_ptr.lock()) access.write_bodies.push_back(runner_ptr.get());
+        for(const std::weak_ptr<DotStaticRigidBody>& floor : m_floor_ptrs)
+        {
+            if( const std::shared_ptr<DotStaticRigidBody> floor_ptr = floor.lock()) access.write_bodies.push_back(floor_ptr.get());
+        }
+    }
+
+    virtual void on_unregister() {
+        release_contact_margin();
+    }
 
-    void add_floor(const std::weak_ptr<DotStaticRigidBody>& floor, float friction = 1.0) { m_floor_ptrs.push_back(floor); m_friction.push_back(friction); }
+    // Forget the floors out of the engine
+    virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
+        m_floor_map.clear();
+        for(size_t i_p_1 = m_floor_ptrs.size(); i_p_1 > 0; i_p_1--)
+        {
+            const size_t i = i_p_1 -1;
+            const std::shared_ptr<DotStaticRigidBody> floor_ptr = m_floor_ptrs[i].lock();
+            if( !floor_ptr || floor_ptr->is_destroyed() )
+            {
+                std::swap(m_floor_ptrs[i], m_floor_ptrs.back());
+                m_floor_ptrs.pop_back();
+                std::swap(m_friction[i], m_friction.back());
+                m_friction.pop_back();
+            }
+            else m_floor_map[floor_ptr.get()] = {floor_ptr.get(), m_friction[i]};
+        }
+    }
 
     virtual void apply( [[maybe_unused]] const float delta_t ) {
         if( m_dir != 0 )
         {
             const std::shared_ptr<DotStaticRigidBody> runner_ptr = m_runner_ptr.lock();
+            if( !runner_ptr ) return;
 
             Float2d best_dir = Float2d(0.0, 0.0);
-            bool run_found = false;
-            float best_dist = m_distance_threshold;
-            std::shared_ptr<DotStaticRigidBody> best_wall = nullptr;
+            DotStaticRigidBody* best_wall = nullptr;
             float best_friction = 0.0;
 
-            for(size_t i_p_1 = m_floor_ptrs.size(); i_p_1 > 0; i_p_1--)
-            {
-                const size_t i = i_p_1 -1;
-                const std::shared_ptr<DotStaticRigidBody> wall_ptr = m_floor_ptrs[i].lock();
-                if( !wall_ptr || wall_ptr->is_destroyed() )
-                {
-                    std::swap(m_floor_ptrs[i], m_floor_ptrs.back());
-                    m_floor_ptrs.pop_back();
-                    std::swap(m_friction[i], m_friction.back());
-                    m_friction.pop_back();
-                }
-                else
-                {
-                    Float2d w2j = runner_ptr->get_position() - wall_ptr->get_position();
-                    float w2j_norm = w2j.norm();
-                    float dist = w2j_norm - (runner_ptr->get_size() + wall_ptr->get_size() );
-                    if( dist < best_dist)
-                    {
-                        best_dist = dist;
-                        best_dir = w2j/w2j_norm;
-                        run_found = true;
-                        best_wall = wall_ptr;
-                        best_friction = m_friction[i];
-                    }
-                }
-            }
-
-            if( run_found )
+            if( find_floor(runner_ptr.get(), best_dir, best_wall, best_friction) )
             {
                 Float2d force;
                 if( m_dir > 0 ) force = best_friction* m_running_value * best_dir.perpendicular_clock();
@@ -80,6 +119,33 @@ class DotRunningForce : public DotSystemInterface
     }
 };
 
+bool DotRunningForce::find_floor(const DotStaticRigidBody* const runner_ptr, Float2d& best_dir, DotStaticRigidBody*& best_floor, float& best_friction) const
+{
+    if( !m_contact_adjacency_ptr ) return false;
+
+    bool run_found = false;
+    float best_dist = m_distance_threshold;
+    for(const size_t collision_id : m_contact_adjacency_ptr->get_collision_ids(runner_ptr))
+    {
+        const std::unordered_map<const DotBodyInterface*, Floor>::const_iterator floor_it = m_floor_map.find(m_contact_adjacency_ptr->get_other_body(collision_id, runner_ptr));
+        if( floor_it == m_floor_map.end() ) continue;
+        DotStaticRigidBody* const wall_ptr = floor_it->second.floor_ptr;
+
+        // Contact normal from the wall to the runner, the center direction for circles
+        Float2d w2j_dir;
+        const float dist = DotBodyInterface::getContact(wall_ptr, runner_ptr, w2j_dir);
+        if( dist < best_dist)
+        {
+            best_dist = dist;
+            best_dir = w2j_dir;
+            run_found = true;
+            best_floor = wall_ptr;
+            best_friction = floor_it->second.friction;
+        }
+    }
+    return run_found;
+}
+
 class DotIntuitiveRunningForce : public DotRunningForce
 {
     public:
@@ -88,41 +154,13 @@ class DotIntuitiveRunningForce : public DotRunningForce
         if( m_dir != 0 )
         {
             const std::shared_ptr<DotStaticRigidBody> runner_ptr = m_runner_ptr.lock();
+            if( !runner_ptr ) return;
 
             Float2d best_dir = Float2d(0.0, 0.0);
-            bool run_found = false;
-            float best_dist = m_distance_threshold;
-            std::shared_ptr<DotStaticRigidBody> best_wall = nullptr;
+            DotStaticRigidBody* best_wall = nullptr;
             float best_friction = 0.0;
 
-            for(size_t i_p_1 = m_floor_ptrs.size(); i_p_1 > 0; i_p_1--)
-            {
-                const size_t i = i_p_1 -1;
-                const std::shared_ptr<DotStaticRigidBody> wall_ptr = m_floor_ptrs[i].lock();
-                if( !wall_ptr || wall_ptr->is_destroyed() )
-                {
-                    std::swap(m_floor_ptrs[i], m_floor_ptrs.back());
-                    m_floor_ptrs.pop_back();
-                    std::swap(m_friction[i], m_friction.back());
-                    m_friction.pop_back();
-                }
-                else
-                {
-                    Float2d w2j = runner_ptr->get_position() - wall_ptr->get_position();
-                    float w2j_norm = w2j.norm();
-                    float dist = w2j_norm - (runner_ptr->get_size() + wall_ptr->get_size() );
-                    if( dist < best_dist)
-                    {
-                        best_dist = dist;
-                        best_dir = w2j/w2j_norm;
-                        run_found = true;
-                        best_wall = wall_ptr;
-                        best_friction = m_friction[i];
-                    }
-                }
-            }
-
-            if( run_found )
+            if( find_floor(runner_ptr.get(), best_dir, best_wall, best_friction) )
             {
                 Float2d force_dir = best_dir.perpendicular_clock();
                 if( m_dir > 0 && force_dir.x() < 0.0 ) force_dir = -force_dir;
@@ -133,4 +171,4 @@ class DotIntuitiveRunningForce : public DotRunningForce
             }
         }
     }
-};
\ No newline at end of file
+};
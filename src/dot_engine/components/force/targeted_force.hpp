@@ -3,12 +3,32 @@
 
 #pragma once
 
+// The force is kept in the constant force of the target, apply only write when the target or the value change
 class DotTargetedForce : public DotSystemInterface
 {
     private:
     std::weak_ptr<DotDynamicRigidBody> m_target_ptr;
     Float2d m_value;
 
+    // Target and value held in the constant force of the target
+    std::weak_ptr<DotDynamicRigidBody> m_applied_target_ptr;
+    Float2d m_applied_value;
+
+    bool is_applied() const {
+        return m_applied_target_ptr.lock() == m_target_ptr.lock() && m_applied_value.x() == m_value.x() && m_applied_value.y() == m_value.y();
+    }
+
+    // Remove the applied value from the constant force, with a force to cancel the tick in progress
+    void release() {
+        if( const std::shared_ptr<DotDynamicRigidBody> applied_target_ptr = m_applied_target_ptr.lock())
+        {
+            applied_target_ptr->add_constant_force(-m_applied_value);
+            applied_target_ptr->addForce(-m_applied_value);
+        }
+        m_applied_target_ptr.reset();
+        m_applied_value = Float2d();
+    }
+
     public:
     Float2d get_value() const { return m_value; }
     void set_value(const Float2d& value) {m_value = value;}
@@ -16,10 +36,27 @@ class DotTargetedForce : public DotSystemInterface
     std::weak_ptr<DotDynamicRigidBody> get_target() const {return m_target_ptr;}
     void set_target(const std::weak_ptr<DotDynamicRigidBody>& target) { m_target_ptr = target;}
 
+    // The graph is not rebuilt when the value change, both targets are always declared
+    virtual void declare_access(DotSystemAccess& access) const {
+        if( const std::shared_ptr<DotDynamicRigidBody> applied_target_ptr = m_applied_target_ptr.lock()) access.write_bodies.push_back(applied_target_ptr.get());
+        const std::shared_ptr<DotDynamicRigidBody> target_ptr = get_target().lock();
+        if( target_ptr && target_ptr != m_applied_target_ptr.lock() ) access.write_bodies.push_back(target_ptr.get());
+    }
+
+    virtual void on_unregister() {
+        release();
+    }
+
+    // As a high resolution system, a change take full effect at the next tick
     virtual void apply( [[maybe_unused]] const float delta_t ) {
         if( const std::shared_ptr<DotDynamicRigidBody> target_ptr = get_target().lock())
         {
+            if( is_applied() ) return;
+            release();
+            target_ptr->add_constant_force(get_value());
             target_ptr->addForce(get_value());
+            m_applied_target_ptr = target_ptr;
+            m_applied_value = get_value();
         }
         else
         {
@@ -9,22 +9,39 @@ class DotUniversalLawDrag : public DotSystemInterface
     private:
     float m_b;
     std::vector<DotDynamicRigidBody*> m_body_buffer;
+    // Same bodies indexed by engine body id, nullptr for non dynamic body
+    std::vector<DotDynamicRigidBody*> m_body_by_id;
+    std::function<void(const DotThreadTask&)> m_apply_multithread_function;
 
     public:
     float get_b() const { return -m_b; }
     void set_b( const float value ) { m_b = -value; }
-    DotUniversalLawDrag(const float b ):m_b(-b){}
+    DotUniversalLawDrag(const float b ):
+    m_b(-b),
+    m_apply_multithread_function(std::bind(&DotUniversalLawDrag::apply_multithread_function, this, std::placeholders::_1))
+    {}
+    DotUniversalLawDrag(const DotUniversalLawDrag& other):DotUniversalLawDrag(other.get_b()){}
     virtual ~DotUniversalLawDrag(){}
 
     virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
         m_body_buffer.clear();
+        m_body_by_id.clear();
         for(const std::shared_ptr<DotBodyInterface>& body_ptr : body_ptrs)
         {
             DotDynamicRigidBody* const dynamic_body_ptr = dynamic_cast<DotDynamicRigidBody* const>(body_ptr.get());
             if( dynamic_body_ptr ) m_body_buffer.emplace_back(dynamic_body_ptr);
+            m_body_by_id.emplace_back(dynamic_body_ptr);
         }
     }
 
+    virtual bool is_body_pass_system() const { return true; }
+
+    virtual void apply_on_body(const size_t body_id, [[maybe_unused]] const float delta_t)
+    {
+        DotDynamicRigidBody* const body_ptr = m_body_by_id[body_id];
+        if( body_ptr ) body_ptr->addForce( body_ptr->get_speed() * m_b * body_ptr->get_size() );
+    }
+
     void apply_multithread_function(const DotThreadTask& task)
     {
         const size_t end_excluded = task.id_size+task.id_start;
@@ -37,8 +54,7 @@ class DotUniversalLawDrag : public DotSystemInterface
 
     virtual void apply( [[maybe_unused]] const float delta_t ) {
 
-        static const std::function<void(const DotThreadTask&)> custom_fct = std::bind(&DotUniversalLawDrag::apply_multithread_function, this, std::placeholders::_1);
-        m_multi_thread_helper_ptr->custom_function(delta_t, m_body_buffer.size(), &custom_fct);
+        m_multi_thread_helper_ptr->custom_function(delta_t, m_body_buffer.size(), &m_apply_multithread_function);
         return;
     }
 };
\ No newline at end of file
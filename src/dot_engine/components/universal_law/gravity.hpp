@@ -2,37 +2,97 @@
 #include "../../physic_multithread_helper.hpp"
 #include "../body/dynamic_rigid_body.hpp"
 #include "../body/static_rigid_body.hpp"
+#include "../../utils/barnes_hut_tree.hpp"
+#include "../../utils/field_grid.hpp"
+#include <unordered_set>
 
 #pragma once
 
+// Uniform gravity kept in the constant acceleration of the bodies, it cost nothing per tick
+// The bodies are updated only when they join the engine, when g change and when the law is unregistered
 class DotUniversalLawGravity : public DotSystemInterface
 {
     private:
-    std::vector<DotDynamicRigidBody*> m_body_buffer;
+    struct TrackedBody
+    {
+        std::weak_ptr<DotDynamicRigidBody> body_ptr;
+        // Key of the body set, still valid to erase once the body is freed
+        const DotBodyInterface* key;
+    };
+
+    // Bodies holding g in their constant acceleration
+    std::vector<TrackedBody> m_tracked_bodies;
+    std::unordered_set<const DotBodyInterface*> m_tracked_body_set;
     Float2d m_g;
 
+    // Add g to the constant acceleration of the body, with a force for the tick in progress
+    static void add_to_body(DotDynamicRigidBody* const body_ptr, const Float2d& g){
+        body_ptr->add_constant_acceleration(g);
+        body_ptr->addForce(body_ptr->get_mass() * g);
+    }
+
     public:
     Float2d get_g() const { return m_g; }
-    void set_g( const Float2d& value ) { m_g = value; }
+    // Update every body, !!! LOCK BEFORE !!!
+    void set_g( const Float2d& value ) {
+        for(const TrackedBody& tracked_body : m_tracked_bodies)
+        {
+            if( const std::shared_ptr<DotDynamicRigidBody> body_ptr = tracked_body.body_ptr.lock() ) body_ptr->add_constant_acceleration(value - m_g);
+        }
+        m_g = value;
+    }
     DotUniversalLawGravity(const Float2d& g ):m_g(g){}
+    DotUniversalLawGravity(const DotUniversalLawGravity& other):DotUniversalLawGravity(other.get_g()){}
     virtual ~DotUniversalLawGravity(){}
 
     virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
-        m_body_buffer.clear();
+        // Forget the bodies out of the engine before adding, so a new body at the address of a freed one is not skipped
+        for(size_t i_p_1 = m_tracked_bodies.size(); i_p_1 > 0; i_p_1--)
+        {
+            const size_t i = i_p_1  - 1;
+            const std::shared_ptr<DotDynamicRigidBody> body_ptr = m_tracked_bodies[i].body_ptr.lock();
+            if( body_ptr && !body_ptr->is_destroyed() ) continue;
+            m_tracked_body_set.erase(m_tracked_bodies[i].key);
+            std::swap(m_tracked_bodies[i], m_tracked_bodies.back());
+            m_tracked_bodies.pop_back();
+        }
+
         for(const std::shared_ptr<DotBodyInterface>& body_ptr : body_ptrs)
         {
-            DotDynamicRigidBody* const dynamic_body_ptr = dynamic_cast<DotDynamicRigidBody* const>(body_ptr.get());
-            if(dynamic_body_ptr) m_body_buffer.emplace_back(dynamic_body_ptr);
+            if( m_tracked_body_set.count(body_ptr.get()) ) continue;
+            const std::shared_ptr<DotDynamicRigidBody> dynamic_body_ptr = std::dynamic_pointer_cast<DotDynamicRigidBody>(body_ptr);
+            if( !dynamic_body_ptr ) continue;
+            add_to_body(dynamic_body_ptr.get(), m_g);
+            m_tracked_bodies.push_back({dynamic_body_ptr, body_ptr.get()});
+            m_tracked_body_set.insert(body_ptr.get());
         }
     }
 
-    void apply( [[maybe_unused]] const float delta_t) {
-
-        for(DotDynamicRigidBody* const body_ptr : m_body_buffer )
+    virtual void on_unregister(){
+        for(const TrackedBody& tracked_body : m_tracked_bodies)
         {
-            body_ptr->addForce( body_ptr->get_mass() * m_g );
+            if( const std::shared_ptr<DotDynamicRigidBody> body_ptr = tracked_body.body_ptr.lock() ) add_to_body(body_ptr.get(), -m_g);
         }
+        m_tracked_bodies.clear();
+        m_tracked_body_set.clear();
     }
+
+    // Nothing is touched during apply
+    virtual void declare_access([[maybe_unused]] DotSystemAccess& access) const {}
+
+    void apply( [[maybe_unused]] const float delta_t) {}
+};
+
+enum DotAstralGravityMode {
+    // Every body is attracted by every star
+    DIRECT,
+    // Every body is attracted by a Barnes-Hut tree of the stars
+    BARNES_HUT,
+    // Every body is attracted by a Barnes-Hut tree of the stars and of the other bodies
+    NBODY_BARNES_HUT,
+    // Every body sample a cached acceleration field of the stars, rebuilt when a star move or change mass
+    // Bodies next to a star or outside the grids fall back to the Barnes-Hut tree of the stars
+    FIELD_GRID
 };
 
 class DotUniversalLawAstralGravity : public DotSystemInterface
@@ -41,15 +101,78 @@ class DotUniversalLawAstralGravity : public DotSystemInterface
     float m_g;
     std::vector<std::shared_ptr<DotStaticRigidBody>> m_stars;
     std::vector<DotDynamicRigidBody*> m_body_buffer;
+    // Engine body ids of the body buffer
+    std::vector<size_t> m_body_buffer_ids;
+    // Same bodies indexed by engine body id, nullptr for stars and non dynamic bodies
+    std::vector<DotDynamicRigidBody*> m_body_by_id;
+    // Index in the body buffer by engine body id
+    std::vector<size_t> m_body_buffer_index_by_id;
+    std::function<void(const DotThreadTask&)> m_apply_multithread_function;
+
+    // Stars state read by the body pass, so a star is never read while an other thread move it
+    std::vector<Float2d> m_star_positions;
+    std::vector<float> m_star_masses;
+
+    DotAstralGravityMode m_mode;
+    float m_opening_angle;
+    DotBarnesHutTree m_tree;
+
+    DotFieldGrid m_field_grid;
+    size_t m_field_grid_resolution;
+    size_t m_field_grid_level_nbr;
+    bool m_field_grid_changed;
+    std::function<void(const DotThreadTask&)> m_build_field_multithread_function;
+
+    void apply_direct(DotDynamicRigidBody* const body_ptr) const;
+    void apply_tree(DotDynamicRigidBody* const body_ptr, const size_t source_id) const;
+    void apply_field(DotDynamicRigidBody* const body_ptr) const;
+    Float2d get_tree_acceleration(const Float2d& position, const size_t source_id) const;
+    bool update_star_snapshot();
+    void build_field(const float delta_t);
+    void build_field_multithread_function(const DotThreadTask& task);
 
     public:
     float get_g() const { return m_g; }
     void set_g( const float value ) { m_g = value; }
-    DotUniversalLawAstralGravity(const float g ):m_g(g){}
+    DotUniversalLawAstralGravity(const float g ):
+    m_g(g),
+    m_apply_multithread_function(std::bind(&DotUniversalLawAstralGravity::apply_multithread_function, this, std::placeholders::_1)),
+    m_mode(DotAstralGravityMode::DIRECT),
+    m_opening_angle(0.5),
+    m_field_grid_resolution(64),
+    m_field_grid_level_nbr(6),
+    m_field_grid_changed(true),
+    m_build_field_multithread_function(std::bind(&DotUniversalLawAstralGravity::build_field_multithread_function, this, std::placeholders::_1))
+    {}
+    DotUniversalLawAstralGravity(const DotUniversalLawAstralGravity& other):
+    DotUniversalLawAstralGravity(other.get_g())
+    {
+        m_stars = other.m_stars;
+        m_mode = other.m_mode;
+        m_opening_angle = other.m_opening_angle;
+        m_field_grid_resolution = other.m_field_grid_resolution;
+        m_field_grid_level_nbr = other.m_field_grid_level_nbr;
+    }
     virtual ~DotUniversalLawAstralGravity(){}
 
     void register_star(const std::shared_ptr<DotStaticRigidBody>& body) { m_stars.push_back(body); }
 
+    // Tree modes have no magnitude threshold, the threshold of the direct mode would depend on how the sources are grouped
+    DotAstralGravityMode get_mode() const { return m_mode; }
+    void set_mode(const DotAstralGravityMode value) { m_mode = value; m_field_grid_changed = true; }
+
+    // Size / distance under which a group of sources is seen as one mass, 0 is exact and slow
+    float get_opening_angle() const { return m_opening_angle; }
+    void set_opening_angle(const float value) { m_opening_angle = value; m_field_grid_changed = true; }
+
+    // Nodes per side of each field grid level
+    size_t get_field_grid_resolution() const { return m_field_grid_resolution; }
+    void set_field_grid_resolution(const size_t value) { m_field_grid_resolution = value; m_field_grid_changed = true; }
+
+    // Number of field grid levels, the first cover the stars and each next one twice the extent
+    size_t get_field_grid_level_nbr() const { return m_field_grid_level_nbr; }
+    void set_field_grid_level_nbr(const size_t value) { m_field_grid_level_nbr = value; m_field_grid_changed = true; }
+
     virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){
         // clean star
         for(size_t i = m_stars.size(); i > 0; i--)
@@ -66,61 +189,198 @@ class DotUniversalLawAstralGravity : public DotSystemInterface
         }
 
         // sort body
+        std::unordered_set<const DotBodyInterface*> star_set;
+        for(const std::shared_ptr<DotStaticRigidBody>& star : m_stars) star_set.insert(star.get());
         m_body_buffer.clear();
+        m_body_buffer_ids.clear();
+        m_body_by_id.clear();
+        m_body_buffer_index_by_id.clear();
         for(const std::shared_ptr<DotBodyInterface>& body_ptr : body_ptrs)
         {
-            bool is_a_star = false;
-            for(const std::shared_ptr<DotStaticRigidBody>& star : m_stars)
-            {
-                if(dynamic_cast<DotStaticRigidBody*>(body_ptr.get()) ==  star.get())
-                {
-                    is_a_star = true;
-                    break;
-                }
-            }
-            if(is_a_star) continue;
-
-            
-            DotDynamicRigidBody* const dynamic_body_ptr = dynamic_cast<DotDynamicRigidBody* const>(body_ptr.get());
-            if(dynamic_body_ptr) m_body_buffer.emplace_back(dynamic_body_ptr);
+            DotDynamicRigidBody* const dynamic_body_ptr = star_set.count(body_ptr.get()) ? nullptr : dynamic_cast<DotDynamicRigidBody* const>(body_ptr.get());
+            m_body_buffer_index_by_id.emplace_back(m_body_buffer.size());
+            m_body_by_id.emplace_back(dynamic_body_ptr);
+            if(!dynamic_body_ptr) continue;
+            m_body_buffer_ids.emplace_back(m_body_by_id.size() - 1);
+            m_body_buffer.emplace_back(dynamic_body_ptr);
         }
     }
 
+    // Stars and tree are prepared once, then each body is attracted in the per body pass of the engine
+    // In a high resolution fused pass, the bodies of the N-body tree are one step late
+    virtual bool is_body_pass_system() const { return true; }
+    virtual void prepare_body_pass( const float delta_t );
+    virtual void apply_on_body(const size_t body_id, [[maybe_unused]] const float delta_t);
+
     void apply_multithread_function(const DotThreadTask& task)
     {
         const size_t end_excluded = task.id_size+task.id_start;
         for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            DotDynamicRigidBody* const body_ptr = m_body_buffer[i];
-            for(const std::shared_ptr<DotStaticRigidBody>& star : m_stars)
-            {
-                // apply gravity
-                const float g_mult_m = star->get_mass() * m_g;
-                const Float2d star_position = star->get_position();
-
-                const Float2d diff_body2star = star_position - body_ptr->get_position();
-                const float m_body = body_ptr->get_mass();
-                const float d_sq = diff_body2star.norm2() + 0.01;
-                const float magnitude = (g_mult_m * m_body)/d_sq;
-
-                if(magnitude > 0.5 )
-                {
-                    const float d = sqrtf(d_sq);
-                    const Float2d dir_body2star = diff_body2star/d;
-                    
-                    const Float2d force_on_body = dir_body2star*magnitude;
-                    const Float2d force_on_star = -force_on_body;
-
-                    body_ptr->addForce( force_on_body );
-                }
-            }
+            apply_on_body(m_body_buffer_ids[i], task.dt);
         }
     }
 
-    void apply( [[maybe_unused]] const float delta_t ) {
+    void apply( const float delta_t ) {
 
-        static const std::function<void(const DotThreadTask&)> custom_fct = std::bind(&DotUniversalLawAstralGravity::apply_multithread_function, this, std::placeholders::_1);
-        m_multi_thread_helper_ptr->custom_function(delta_t, m_body_buffer.size(), &custom_fct);
+        prepare_body_pass(delta_t);
+        m_multi_thread_helper_ptr->custom_function(delta_t, m_body_buffer.size(), &m_apply_multithread_function);
         return;
     }
-};
\ No newline at end of file
+};
+
+void DotUniversalLawAstralGravity::prepare_body_pass( const float delta_t )
+{
+    const bool stars_changed = update_star_snapshot();
+    if( m_mode == DotAstralGravityMode::FIELD_GRID )
+    {
+        if( stars_changed || m_field_grid_changed ) build_field(delta_t);
+    }
+    else if( m_mode != DotAstralGravityMode::DIRECT )
+    {
+        m_tree.clear();
+        for( size_t i = 0; i < m_star_positions.size(); i++ ) m_tree.add_source(m_star_positions[i], m_star_masses[i]);
+        if( m_mode == DotAstralGravityMode::NBODY_BARNES_HUT )
+        {
+            for(DotDynamicRigidBody* const body_ptr : m_body_buffer) m_tree.add_source(body_ptr->get_position(), body_ptr->get_mass());
+        }
+        m_tree.build();
+    }
+}
+
+void DotUniversalLawAstralGravity::apply_on_body(const size_t body_id, [[maybe_unused]] const float delta_t)
+{
+    DotDynamicRigidBody* const body_ptr = m_body_by_id[body_id];
+    if( !body_ptr ) return;
+
+    switch (m_mode)
+    {
+    case DIRECT:
+        apply_direct(body_ptr);
+        break;
+    case BARNES_HUT:
+        // Bodies are not in the tree, no source is excluded
+        apply_tree(body_ptr, m_tree.get_source_nbr());
+        break;
+    case NBODY_BARNES_HUT:
+        // Bodies are added to the tree after the stars
+        apply_tree(body_ptr, m_star_positions.size() + m_body_buffer_index_by_id[body_id]);
+        break;
+    case FIELD_GRID:
+        apply_field(body_ptr);
+        break;
+    }
+}
+
+void DotUniversalLawAstralGravity::apply_direct(DotDynamicRigidBody* const body_ptr) const
+{
+    const size_t nbr_star = m_star_positions.size();
+    for( size_t i = 0; i < nbr_star; i++ )
+    {
+        // apply gravity
+        const float g_mult_m = m_star_masses[i] * m_g;
+        const Float2d star_position = m_star_positions[i];
+
+        const Float2d diff_body2star = star_position - body_ptr->get_position();
+        const float m_body = body_ptr->get_mass();
+        const float d_sq = diff_body2star.norm2() + 0.01;
+        const float magnitude = (g_mult_m * m_body)/d_sq;
+
+        if(magnitude > 0.5 )
+        {
+            const float d = sqrtf(d_sq);
+            const Float2d dir_body2star = diff_body2star/d;
+
+            const Float2d force_on_body = dir_body2star*magnitude;
+
+            body_ptr->addForce( force_on_body );
+        }
+    }
+}
+
+Float2d DotUniversalLawAstralGravity::get_tree_acceleration(const Float2d& position, const size_t source_id) const
+{
+    // Same law as the direct mode, per unit of body mass
+    Float2d acceleration;
+    m_tree.for_each_source(position, m_opening_angle, [&](const Float2d& source_position, const float source_mass, const size_t other_source_id)
+    {
+        if( other_source_id == source_id ) return;
+        const Float2d diff_body2source = source_position - position;
+        const float d_sq = diff_body2source.norm2() + 0.01;
+        const float d = sqrtf(d_sq);
+        acceleration += diff_body2source * ((m_g * source_mass) / (d_sq * d));
+    });
+    return acceleration;
+}
+
+void DotUniversalLawAstralGravity::apply_tree(DotDynamicRigidBody* const body_ptr, const size_t source_id) const
+{
+    body_ptr->addForce( get_tree_acceleration(body_ptr->get_position(), source_id) * body_ptr->get_mass() );
+}
+
+void DotUniversalLawAstralGravity::apply_field(DotDynamicRigidBody* const body_ptr) const
+{
+    const Float2d position = body_ptr->get_position();
+    Float2d acceleration;
+    if( !m_field_grid.sample(position, acceleration) ) acceleration = get_tree_acceleration(position, m_tree.get_source_nbr());
+    body_ptr->addForce( acceleration * body_ptr->get_mass() );
+}
+
+bool DotUniversalLawAstralGravity::update_star_snapshot()
+{
+    // Copy the stars state, return true when it changed since the last copy
+    const size_t nbr_star = m_stars.size();
+    bool has_changed = m_star_positions.size() != nbr_star;
+    m_star_positions.resize(nbr_star);
+    m_star_masses.resize(nbr_star);
+    for( size_t i = 0; i < nbr_star; i++ )
+    {
+        const Float2d position = m_stars[i]->get_position();
+        const float mass = m_stars[i]->get_mass();
+        if( position.x() != m_star_positions[i].x() || position.y() != m_star_positions[i].y() || mass != m_star_masses[i] )
+        {
+            m_star_positions[i] = position;
+            m_star_masses[i] = mass;
+            has_changed = true;
+        }
+    }
+    return has_changed;
+}
+
+void DotUniversalLawAstralGravity::build_field(const float delta_t)
+{
+    m_tree.clear();
+    for( size_t i = 0; i < m_star_positions.size(); i++ ) m_tree.add_source(m_star_positions[i], m_star_masses[i]);
+    m_tree.build();
+
+    // First level cover the stars with a margin
+    Float2d min_position;
+    Float2d max_position;
+    if( !m_star_positions.empty() )
+    {
+        min_position = m_star_positions[0];
+        max_position = m_star_positions[0];
+    }
+    for( const Float2d& position : m_star_positions )
+    {
+        min_position = Float2d(std::min(min_position.x(), position.x()), std::min(min_position.y(), position.y()));
+        max_position = Float2d(std::max(max_position.x(), position.x()), std::max(max_position.y(), position.y()));
+    }
+    const float half_extent = std::max(std::max(max_position.x() - min_position.x(), max_position.y() - min_position.y()) * 0.75f, 1.0f);
+    m_field_grid.reset((min_position + max_position) / 2, half_extent, m_field_grid_resolution, m_field_grid_level_nbr);
+
+    m_multi_thread_helper_ptr->custom_function(delta_t, m_field_grid.get_node_nbr(), &m_build_field_multithread_function);
+
+    // The field is singular at the stars, bodies close to them use the tree
+    for( const Float2d& position : m_star_positions ) m_field_grid.invalidate_around(position);
+    m_field_grid_changed = false;
+}
+
+void DotUniversalLawAstralGravity::build_field_multithread_function(const DotThreadTask& task)
+{
+    const size_t end_excluded = task.id_size+task.id_start;
+    for(size_t i = task.id_start; i < end_excluded; i++)
+    {
+        m_field_grid.set_node_value(i, get_tree_acceleration(m_field_grid.get_node_position(i), m_tree.get_source_nbr()));
+    }
+}
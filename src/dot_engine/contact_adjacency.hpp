@@ -0,0 +1,83 @@
+#include "./system_interface.hpp"
+#include <span>
+#include <limits>
+#include <unordered_map>
+
+#pragma once
+
+// Body id returned for a body that is not in the engine
+constexpr size_t CONTACT_ADJACENCY_NO_BODY = std::numeric_limits<size_t>::max();
+
+// Collision ids of each body, stored in one array where the contacts of a body are contiguous
+// Rebuilt by the engine every update, a body get its contacts in O(degree)
+class DotContactAdjacency
+{
+    private:
+    const std::vector<DotCollisionInfo>* m_collision_infos_ptr;
+    // Contacts of body i are m_collision_ids[m_offsets[i]] to m_collision_ids[m_offsets[i+1]]
+    std::vector<size_t> m_offsets;
+    std::vector<size_t> m_collision_ids;
+    // Index of each body in the body list, rebuilt only when the list change
+    std::unordered_map<const DotBodyInterface*, size_t> m_body_ids;
+
+    public:
+    DotContactAdjacency():m_collision_infos_ptr(nullptr), m_offsets(1, 0){}
+
+    void update_body_ids(const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs);
+    void build(const size_t nbr_body, const std::vector<DotCollisionInfo>& collision_infos);
+
+    // CONTACT_ADJACENCY_NO_BODY when the body is not in the engine
+    size_t get_body_id(const DotBodyInterface* const body_ptr) const {
+        const std::unordered_map<const DotBodyInterface*, size_t>::const_iterator it = m_body_ids.find(body_ptr);
+        return it != m_body_ids.end() ? it->second : CONTACT_ADJACENCY_NO_BODY;
+    }
+
+    // Index in the collision list of every contact of the body
+    std::span<const size_t> get_collision_ids(const size_t body_id) const {
+        if( body_id + 1 >= m_offsets.size() ) return std::span<const size_t>();
+        return std::span<const size_t>(m_collision_ids.data() + m_offsets[body_id], m_offsets[body_id + 1] - m_offsets[body_id]);
+    }
+    std::span<const size_t> get_collision_ids(const DotBodyInterface* const body_ptr) const { return get_collision_ids(get_body_id(body_ptr)); }
+
+    const DotCollisionInfo& get_collision(const size_t collision_id) const { return (*m_collision_infos_ptr)[collision_id]; }
+
+    // Other body of a contact of body_ptr
+    DotBodyInterface* get_other_body(const size_t collision_id, const DotBodyInterface* const body_ptr) const {
+        const DotCollisionInfo& info = get_collision(collision_id);
+        return info.body_a == body_ptr ? info.body_b : info.body_a;
+    }
+};
+
+void DotContactAdjacency::update_body_ids(const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs)
+{
+    m_body_ids.clear();
+    const size_t nbr_body = body_ptrs.size();
+    for(size_t i = 0; i < nbr_body; i++) m_body_ids.emplace(body_ptrs[i].get(), i);
+}
+
+void DotContactAdjacency::build(const size_t nbr_body, const std::vector<DotCollisionInfo>& collision_infos)
+{
+    m_collision_infos_ptr = &collision_infos;
+
+    // Counting sort of the contact ends by body
+    m_offsets.assign(nbr_body + 1, 0);
+    for(const DotCollisionInfo& info : collision_infos)
+    {
+        m_offsets[info.body_a_id + 1] += 1;
+        m_offsets[info.body_b_id + 1] += 1;
+    }
+    for(size_t i = 0; i < nbr_body; i++) m_offsets[i+1] += m_offsets[i];
+
+    m_collision_ids.resize(m_offsets[nbr_body]);
+    const size_t nbr_collision = collision_infos.size();
+    for(size_t i = 0; i < nbr_collision; i++)
+    {
+        // Offsets of a and b are used as insert positions, then shifted back
+        m_collision_ids[m_offsets[collision_infos[i].body_a_id]] = i;
+        m_offsets[collision_infos[i].body_a_id] += 1;
+        m_collision_ids[m_offsets[collision_infos[i].body_b_id]] = i;
+        m_offsets[collision_infos[i].body_b_id] += 1;
+    }
+    for(size_t i = nbr_body; i > 0; i--) m_offsets[i] = m_offsets[i-1];
+    m_offsets[0] = 0;
+}
@@ -0,0 +1,100 @@
+#include "./system_interface.hpp"
+#include <unordered_map>
+#include <functional>
+
+#pragma once
+
+// Pair of bodies ordered by address, so a pair has one key whatever the order of the collision
+struct DotContactPair
+{
+    DotBodyInterface* body_a;
+    DotBodyInterface* body_b;
+
+    DotContactPair(DotBodyInterface* const _body_a, DotBodyInterface* const _body_b):
+    body_a(std::less<DotBodyInterface*>()(_body_a, _body_b) ? _body_a : _body_b),
+    body_b(std::less<DotBodyInterface*>()(_body_a, _body_b) ? _body_b : _body_a)
+    {}
+
+    bool operator==(const DotContactPair& other) const { return body_a == other.body_a && body_b == other.body_b; }
+};
+
+// Changes of the touching pairs between two updates, pairs only kept by the contact margin are not tracked
+struct DotContactEvents
+{
+    // Index in the collision list of the pairs that start touching
+    std::vector<size_t> begin_collision_ids;
+    // Index in the collision list of the pairs that were already touching
+    std::vector<size_t> persist_collision_ids;
+    // Pairs that stopped touching, destroyed bodies are kept alive by the engine until the next update
+    std::vector<DotContactPair> end_pairs;
+};
+
+// Touching pairs of the last update in a hash map, each update give the begin, persist and end events
+class DotContactTracker
+{
+    private:
+    struct PairHash
+    {
+        size_t operator()(const DotContactPair& pair) const noexcept {
+            const size_t hash_a = std::hash<const void*>()(pair.body_a);
+            const size_t hash_b = std::hash<const void*>()(pair.body_b);
+            return hash_a ^ (hash_b + 0x9e3779b97f4a7c15 + (hash_a << 6) + (hash_a >> 2));
+        }
+    };
+
+    // Touching pairs with the number of the last update where they were seen
+    std::unordered_map<DotContactPair, size_t, PairHash> m_active_pairs;
+    size_t m_update_nbr;
+    DotContactEvents m_events;
+
+    public:
+    DotContactTracker():m_update_nbr(0){}
+
+    void update(const std::vector<DotCollisionInfo>& collision_infos);
+
+    // Forget every pair without end event
+    void clear() {
+        m_active_pairs.clear();
+        m_events.begin_collision_ids.clear();
+        m_events.persist_collision_ids.clear();
+        m_events.end_pairs.clear();
+    }
+
+    size_t get_active_pair_nbr() const { return m_active_pairs.size(); }
+    const DotContactEvents& get_events() const { return m_events; }
+};
+
+void DotContactTracker::update(const std::vector<DotCollisionInfo>& collision_infos)
+{
+    m_update_nbr += 1;
+    m_events.begin_collision_ids.clear();
+    m_events.persist_collision_ids.clear();
+    m_events.end_pairs.clear();
+
+    const size_t nbr_collision = collision_infos.size();
+    for(size_t i = 0; i < nbr_collision; i++)
+    {
+        const DotCollisionInfo& info = collision_infos[i];
+        if( !info.is_touching ) continue;
+
+        const std::pair<std::unordered_map<DotContactPair, size_t, PairHash>::iterator, bool> insert_result = m_active_pairs.try_emplace(DotContactPair(info.body_a, info.body_b), m_update_nbr);
+        if( insert_result.second ) m_events.begin_collision_ids.push_back(i);
+        else if( insert_result.first->second != m_update_nbr )
+        {
+            insert_result.first->second = m_update_nbr;
+            m_events.persist_collision_ids.push_back(i);
+        }
+    }
+
+    // Pairs not seen in this update have ended
+    for(std::unordered_map<DotContactPair, size_t, PairHash>::iterator it = m_active_pairs.begin(); it != m_active_pairs.end();)
+    {
+        if( it->second == m_update_nbr )
+        {
+            it++;
+            continue;
+        }
+        m_events.end_pairs.push_back(it->first);
+        it = m_active_pairs.erase(it);
+    }
+}
@@ -1,45 +1,154 @@
 #include "./system_interface.hpp"
 #include "./collision_sorter.hpp"
 #include "./physic_multithread_helper.hpp"
+#include "./system_graph.hpp"
+#include "./spatial_query.hpp"
+#include "./contact_adjacency.hpp"
+#include "./contact_events.hpp"
+#include "./utils/command_queue.hpp"
+#include "./utils/circle_bvh.hpp"
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <functional>
+#include <type_traits>
 #pragma once
 
+// Smaller query batches run on the calling thread
+constexpr size_t SPATIAL_QUERY_MULTITHREAD_MINIMUM_BATCH = 64;
+
 class DotEngine {
     private:
     std::vector<std::shared_ptr<DotBodyInterface>> m_body_ptrs;
 
     std::vector<std::shared_ptr<DotSystemInterface>> m_low_resolution_system_ptrs;
+    std::vector<std::shared_ptr<DotSystemInterface>> m_low_resolution_body_system_ptrs;
     std::vector<std::shared_ptr<DotSystemInterface>> m_high_resolution_system_ptrs;
+    std::vector<std::shared_ptr<DotSystemInterface>> m_high_resolution_body_system_ptrs;
 
     std::vector<std::vector<size_t>> m_collision_sort_result_buffer;
+    // Motion of the tick of every body, empty when no body has continuous collision
+    std::vector<Float2d> m_body_sweep_buffer;
     std::vector<DotCollisionInfo>    m_collision_result_buffer;
+    DotContactAdjacency m_contact_adjacency;
+    // Collisions of each distinct filter of the systems, filled by the narrow phase
+    std::vector<DotCollisionFilter> m_collision_filters;
+    std::vector<std::vector<DotCollisionInfo>> m_collision_channel_buffers;
+    // Pairs with a sensor body, they skip the collision list and the contact response
+    std::vector<DotCollisionInfo>    m_sensor_result_buffer;
 
     DotPhysicMultithreadHelper m_multi_thread_helper;
 
+    DotSystemGraph m_low_resolution_system_graph;
+    DotSystemGraph m_high_resolution_system_graph;
+
     bool m_body_list_changed;
+    bool m_system_graph_changed;
+    bool m_collision_channels_changed;
+    // Incremented each time a body is added or removed
+    size_t m_body_list_version;
+
+    // Begin, persist and end of the touching pairs, tracked only when enabled
+    bool m_contact_events_enabled;
+    DotContactTracker m_contact_tracker;
+    // Bodies removed in the last update, kept alive so the end events can point to them
+    std::vector<std::shared_ptr<DotBodyInterface>> m_removed_body_ptrs;
+
+    // Commands pushed by other threads, executed at the start of the next update
+    DotCommandQueue<std::function<void(DotEngine&)>> m_commands;
+
+    // Adaptive high resolution, the multiplier given to update is the maximum number of high resolution steps
+    bool m_adaptive_high_resolution;
+    size_t m_adaptive_min_multiplier;
+    // Maximum sqrt(stiffness/mass)*dt of a high resolution step
+    float m_adaptive_stiffness_step_limit;
+    // Maximum displacement of a body during a high resolution step, relative to its size
+    float m_adaptive_motion_step_limit;
+    float m_max_speed_to_size_ratio;
+    size_t m_last_high_resolution_multiplier;
+
+    size_t compute_adaptive_high_resolution_multiplier(const float delta_t, const size_t max_multiplier) const;
+
+    // Multi rate, only the bodies touched by high resolution systems do the high resolution steps
+    bool m_multi_rate_high_resolution;
+    DotSystemAccess m_high_resolution_access_buffer;
+    std::unordered_set<const DotBodyInterface*> m_high_resolution_body_set;
+    std::vector<size_t> m_high_resolution_body_ids;
+    std::vector<size_t> m_low_resolution_body_ids;
+
+    bool split_high_resolution_bodies();
+
+    void update_collision_channels();
+    const std::vector<DotCollisionInfo>& get_collision_channel(const size_t channel_id) const {
+        return channel_id == COLLISION_CHANNEL_ALL ? m_collision_result_buffer : m_collision_channel_buffers[channel_id];
+    }
+
+    // Bounding volume hierarchy of the bodies for the spatial queries, built on the first query after a change
+    DotCircleBvh m_spatial_index;
+    // Body id of every circle and shape bounds of the spatial index, destroyed bodies are left out
+    std::vector<size_t> m_spatial_index_body_ids;
+    bool m_spatial_index_valid;
+
+    // Surface distance from point and first hit of a segment for the shapes in the spatial index by their bounds
+    float get_spatial_shape_distance(const size_t circle_id, const Float2d& point) const;
+    bool spatial_shape_raycast(const size_t circle_id, const Float2d& start, const Float2d& direction, float& fraction, Float2d& normal) const;
+
+    void update_spatial_index();
+    void run_spatial_queries(const size_t nbr_query, const std::function<void(const DotThreadTask&)>& function);
+
+    static void prepare_body_pass(const std::vector<std::shared_ptr<DotSystemInterface>>& system_ptrs, const float delta_t){
+        for(const std::shared_ptr<DotSystemInterface>& system: system_ptrs) system->prepare_body_pass(delta_t);
+    }
 
     public:
 
-    DotEngine():
-    m_body_list_changed(false),
+    // Engines built on a same thread pool share its threads, without pool the engine create its own
+    explicit DotEngine(std::shared_ptr<DotPhysicThreadPool> thread_pool_ptr = nullptr):
     m_multi_thread_helper(
         m_body_ptrs,
         m_low_resolution_system_ptrs,
+        m_low_resolution_body_system_ptrs,
         m_high_resolution_system_ptrs,
+        m_high_resolution_body_system_ptrs,
         m_collision_sort_result_buffer,
+        m_body_sweep_buffer,
         m_collision_result_buffer,
-        8
-    )
+        m_collision_filters,
+        m_collision_channel_buffers,
+        m_sensor_result_buffer,
+        std::move(thread_pool_ptr)
+    ),
+    m_body_list_changed(false),
+    m_system_graph_changed(true),
+    m_collision_channels_changed(true),
+    m_body_list_version(0),
+    m_contact_events_enabled(false),
+    m_adaptive_high_resolution(false),
+    m_adaptive_min_multiplier(1),
+    m_adaptive_stiffness_step_limit(0.1),
+    m_adaptive_motion_step_limit(0.25),
+    m_max_speed_to_size_ratio(0.0),
+    m_last_high_resolution_multiplier(0),
+    m_multi_rate_high_resolution(false),
+    m_spatial_index_valid(false)
     {
 
     }
 
     void update(const float delta_t, const size_t division = 0);
 
+    // High resolution body pass systems join the per body passes of the high resolution loop
+    // Low resolution body pass systems share a single per body pass before the other low resolution systems
     void register_system(std::shared_ptr<DotSystemInterface> system_ptr, bool is_high_resolution = false){
         system_ptr->on_body_list_update(m_body_ptrs);   
         system_ptr->set_multi_thread_helper_ptr(&m_multi_thread_helper);
-        if( is_high_resolution) m_high_resolution_system_ptrs.emplace_back(std::move(system_ptr));
+        system_ptr->set_contact_adjacency_ptr(&m_contact_adjacency);
+        if( is_high_resolution && system_ptr->is_body_pass_system()) m_high_resolution_body_system_ptrs.emplace_back(std::move(system_ptr));
+        else if( system_ptr->is_body_pass_system()) m_low_resolution_body_system_ptrs.emplace_back(std::move(system_ptr));
+        else if( is_high_resolution) m_high_resolution_system_ptrs.emplace_back(std::move(system_ptr));
         else m_low_resolution_system_ptrs.emplace_back(std::move(system_ptr));
+        m_system_graph_changed = true;
+        m_collision_channels_changed = true;
     }
 
     void register_system_low_resolution(std::shared_ptr<DotSystemInterface> system_ptr){
@@ -53,14 +162,172 @@ class DotEngine {
     void register_body(std::shared_ptr<DotBodyInterface> body_ptr){
         m_body_ptrs.emplace_back(std::move(body_ptr));
         m_body_list_changed = true;
+        m_body_list_version += 1;
+        m_spatial_index_valid = false;
     }
 
+    // Commands are thread safe and do not need the engine lock, they are executed at the start of the next update
+    void push_command(std::function<void(DotEngine&)> command){ m_commands.push(std::move(command)); }
+
+    void push_register_body(std::shared_ptr<DotBodyInterface> body_ptr){
+        push_command([body_ptr](DotEngine& engine){ engine.register_body(body_ptr); });
+    }
+
+    void push_register_system(std::shared_ptr<DotSystemInterface> system_ptr, const bool is_high_resolution = false){
+        push_command([system_ptr, is_high_resolution](DotEngine& engine){ engine.register_system(system_ptr, is_high_resolution); });
+    }
+
+    // Body or system, removed from the engine in the same update
+    void push_destroy(std::shared_ptr<Destroyable> destroyable_ptr){
+        push_command([destroyable_ptr]([[maybe_unused]] DotEngine& engine){ destroyable_ptr->destroy(); });
+    }
+
+    template<typename Body>
+    void push_apply_impulse(std::shared_ptr<Body> body_ptr, const Float2d& impulse){
+        push_command([body_ptr, impulse]([[maybe_unused]] DotEngine& engine){ body_ptr->apply_impulse(impulse); });
+    }
+
+    // Call setter on target, ex: push_set_parameter(run_force_ptr, &DotRunningForce::set_direction, 1)
+    template<typename Target, typename Owner, typename Value>
+    void push_set_parameter(std::shared_ptr<Target> target_ptr, void (Owner::*setter)(Value), std::remove_cvref_t<Value> value){
+        push_command([target_ptr, setter, value]([[maybe_unused]] DotEngine& engine){ (target_ptr.get()->*setter)(value); });
+    }
+
+    const std::vector<std::shared_ptr<DotBodyInterface>>& get_bodies() const { return m_body_ptrs; }
+    // Contacts of each body for the last update, body ids index get_bodies()
+    const DotContactAdjacency& get_contact_adjacency() const { return m_contact_adjacency; }
+    // Pairs with a sensor body for the last update, body ids index get_bodies()
+    const std::vector<DotCollisionInfo>& get_sensor_overlaps() const { return m_sensor_result_buffer; }
+
+    // Track the touching pairs between updates and give their changes to the systems with on_contact_events
+    bool get_contact_events_enabled() const { return m_contact_events_enabled; }
+    // Disabling forget the tracked pairs without end event, !!! LOCK BEFORE !!!
+    void set_contact_events_enabled(const bool value) {
+        m_contact_events_enabled = value;
+        if( !value ) m_contact_tracker.clear();
+    }
+    // Contact events of the last update, collision ids index the collision list of the last update
+    const DotContactEvents& get_contact_events() const { return m_contact_tracker.get_events(); }
+    size_t get_body_list_version() const { return m_body_list_version; }
+
+    // Adaptive high resolution, the multiplier given to update become the maximum number of high resolution steps
+    bool get_adaptive_high_resolution() const { return m_adaptive_high_resolution; }
+    void set_adaptive_high_resolution(const bool value, const size_t min_multiplier = 1) {
+        m_adaptive_high_resolution = value;
+        m_adaptive_min_multiplier = min_multiplier;
+    }
+
+    // Maximum sqrt(stiffness/mass)*dt of an adaptive high resolution step
+    float get_adaptive_stiffness_step_limit() const { return m_adaptive_stiffness_step_limit; }
+    void set_adaptive_stiffness_step_limit(const float value) { m_adaptive_stiffness_step_limit = value; }
+
+    // Maximum displacement of a body during an adaptive high resolution step, relative to its size
+    float get_adaptive_motion_step_limit() const { return m_adaptive_motion_step_limit; }
+    void set_adaptive_motion_step_limit(const float value) { m_adaptive_motion_step_limit = value; }
+
+    // Number of high resolution steps done by the last update
+    size_t get_last_high_resolution_multiplier() const { return m_last_high_resolution_multiplier; }
+
+    // Multi rate, bodies not touched by a high resolution system do a single high resolution step of the whole delta_t
+    bool get_multi_rate_high_resolution() const { return m_multi_rate_high_resolution; }
+    void set_multi_rate_high_resolution(const bool value) { m_multi_rate_high_resolution = value; }
+
+    // Rebuild the system graph at next update, to call when a registered system change the bodies it touches, !!! LOCK BEFORE !!!
+    void invalidate_system_graph(){ m_system_graph_changed = true; }
+
+    // Read the collision filters of the systems again at next update, to call when a registered system change its filter, !!! LOCK BEFORE !!!
+    void invalidate_collision_channels(){ m_collision_channels_changed = true; }
+
+    // Spatial queries over the bodies, run on the thread pool, not callable from a system, !!! LOCK BEFORE !!!
+    void query_radius(std::span<DotRadiusQuery> queries);
+    void query_nearest(std::span<DotNearestQuery> queries);
+    void raycast(std::span<DotRaycastQuery> queries);
+
+    // Rebuild the spatial index at next query, to call when bodies are moved or resized outside of update, !!! LOCK BEFORE !!!
+    void invalidate_spatial_index(){ m_spatial_index_valid = false; }
+
 };
 
-void DotEngine::update(const float delta_t, const size_t high_resolution_multiplier)
+size_t DotEngine::compute_adaptive_high_resolution_multiplier(const float delta_t, const size_t max_multiplier) const
+{
+    float max_stiffness_to_mass_ratio = 0.0;
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs)
+    {
+        max_stiffness_to_mass_ratio = std::max(max_stiffness_to_mass_ratio, system->get_max_stiffness_to_mass_ratio());
+    }
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs)
+    {
+        max_stiffness_to_mass_ratio = std::max(max_stiffness_to_mass_ratio, system->get_max_stiffness_to_mass_ratio());
+    }
+
+    const float stiffness_multiplier = delta_t * sqrtf(max_stiffness_to_mass_ratio) / m_adaptive_stiffness_step_limit;
+    const float motion_multiplier = delta_t * m_max_speed_to_size_ratio / m_adaptive_motion_step_limit;
+    const size_t multiplier = size_t(ceilf(std::max(stiffness_multiplier, motion_multiplier)));
+
+    return std::clamp(multiplier, std::min(m_adaptive_min_multiplier, max_multiplier), max_multiplier);
+}
+
+void DotEngine::update_collision_channels()
+{
+    // Systems with the same filter share a channel, the channels are few so a linear search is enough
+    m_collision_filters.clear();
+    const auto assign_channel = [this](const std::shared_ptr<DotSystemInterface>& system)
+    {
+        DotCollisionFilter filter;
+        if( !system->get_collision_filter(filter) )
+        {
+            system->set_collision_channel_id(COLLISION_CHANNEL_ALL);
+            return;
+        }
+        const std::vector<DotCollisionFilter>::const_iterator it = std::find(m_collision_filters.begin(), m_collision_filters.end(), filter);
+        system->set_collision_channel_id(size_t(it - m_collision_filters.begin()));
+        if( it == m_collision_filters.end() ) m_collision_filters.push_back(filter);
+    };
+    for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_system_ptrs) assign_channel(system);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_body_system_ptrs) assign_channel(system);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs) assign_channel(system);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs) assign_channel(system);
+    m_collision_channel_buffers.resize(m_collision_filters.size());
+    m_collision_channels_changed = false;
+}
+
+bool DotEngine::split_high_resolution_bodies()
 {
-    // Awake threads from multithread helper
-    m_multi_thread_helper.awake();
+    m_high_resolution_access_buffer.exclusive = false;
+    m_high_resolution_access_buffer.read_bodies.clear();
+    m_high_resolution_access_buffer.write_bodies.clear();
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs)
+    {
+        if( !system->declare_high_resolution_bodies(m_high_resolution_access_buffer) ) return false;
+    }
+
+    m_high_resolution_body_set.clear();
+    m_high_resolution_body_set.insert(m_high_resolution_access_buffer.read_bodies.begin(), m_high_resolution_access_buffer.read_bodies.end());
+    m_high_resolution_body_set.insert(m_high_resolution_access_buffer.write_bodies.begin(), m_high_resolution_access_buffer.write_bodies.end());
+
+    m_high_resolution_body_ids.clear();
+    m_low_resolution_body_ids.clear();
+    const size_t nbr_body = m_body_ptrs.size();
+    for(size_t i = 0; i < nbr_body; i++)
+    {
+        const DotBodyInterface* const body_ptr = m_body_ptrs[i].get();
+        if( m_high_resolution_body_set.count(body_ptr) || body_ptr->requires_high_resolution_steps() ) m_high_resolution_body_ids.push_back(i);
+        else m_low_resolution_body_ids.push_back(i);
+    }
+    return true;
+}
+
+void DotEngine::update(const float delta_t, const size_t max_high_resolution_multiplier)
+{
+    // Commands from other threads
+    m_commands.drain([this](std::function<void(DotEngine&)>& command){ command(*this); });
+
+    // The end events of the last update were given, the removed bodies can be freed
+    m_removed_body_ptrs.clear();
+
+    m_spatial_index_valid = false;
+    m_max_speed_to_size_ratio = 0.0;
+    bool has_continuous_collision = false;
 
     // Body cleaning and on_low_resolution_loop_start
     for(size_t i_p_1 = m_body_ptrs.size(); i_p_1 > 0; i_p_1--)
@@ -69,55 +336,128 @@ void DotEngine::update(const float delta_t, const size_t high_resolution_multipl
         const std::shared_ptr<DotBodyInterface>& body_ptr = m_body_ptrs[i];
         if(body_ptr->is_destroyed())
         {
+            if( m_contact_events_enabled ) m_removed_body_ptrs.push_back(body_ptr);
             std::swap(m_body_ptrs[i], m_body_ptrs.back());
             m_body_ptrs.pop_back();
             m_body_list_changed = true;
+            m_body_list_version += 1;
+        }
+        else
+        {
+            body_ptr->on_low_resolution_loop_start(delta_t);
+            if( m_adaptive_high_resolution && body_ptr->get_size() > 0.0 )
+            {
+                m_max_speed_to_size_ratio = std::max(m_max_speed_to_size_ratio, body_ptr->get_speed().norm() / body_ptr->get_size());
+            }
+            has_continuous_collision |= body_ptr->has_continuous_collision();
+        }
+    }
+
+    // Continuous collision bodies are swept along their speed over the tick, the buffer stay empty without them
+    m_body_sweep_buffer.clear();
+    if( has_continuous_collision )
+    {
+        m_body_sweep_buffer.resize(m_body_ptrs.size());
+        for(size_t i = 0; i < m_body_ptrs.size(); i++)
+        {
+            if( m_body_ptrs[i]->has_continuous_collision() ) m_body_sweep_buffer[i] = m_body_ptrs[i]->get_speed() * delta_t;
         }
-        else body_ptr->on_low_resolution_loop_start(delta_t);
     }
 
-    // Collision calculation
-    generate_collision_pool(m_body_ptrs, m_collision_sort_result_buffer);
+    // Collision calculation, the narrow phase also fill the collision channels
+    if( m_collision_channels_changed ) update_collision_channels();
+    generate_collision_pool(m_body_ptrs, m_body_sweep_buffer, m_collision_sort_result_buffer);
     m_multi_thread_helper.body_has_collision();
+    if( m_body_list_changed ) m_contact_adjacency.update_body_ids(m_body_ptrs);
+    m_contact_adjacency.build(m_body_ptrs.size(), m_collision_result_buffer);
 
     // update systems
     if( m_body_list_changed)
     {
         for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_system_ptrs)
         {
-            system->on_collision_list_update(m_collision_result_buffer);
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
+            system->on_body_list_update(m_body_ptrs);
+        }
+        for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_body_system_ptrs)
+        {
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
             system->on_body_list_update(m_body_ptrs);
         }
         for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs)
         {
-            system->on_collision_list_update(m_collision_result_buffer);
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
+            system->on_body_list_update(m_body_ptrs);
+        }
+        for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs)
+        {
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
             system->on_body_list_update(m_body_ptrs);
         }
         m_body_list_changed = false;
+        m_system_graph_changed = true;
     }
     else
     {
         for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_system_ptrs)
         {
-            system->on_collision_list_update(m_collision_result_buffer);
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
+        }
+        for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_body_system_ptrs)
+        {
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
         }
         for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs)
         {
-            system->on_collision_list_update(m_collision_result_buffer);
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
+        }
+        for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs)
+        {
+            system->on_collision_list_update(get_collision_channel(system->get_collision_channel_id()));
         }
 
     }
 
-    // low resolutionsystem cleaning and apply
+    // Sensor pairs
+    for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_system_ptrs) system->on_sensor_list_update(m_sensor_result_buffer);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_body_system_ptrs) system->on_sensor_list_update(m_sensor_result_buffer);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs) system->on_sensor_list_update(m_sensor_result_buffer);
+    for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs) system->on_sensor_list_update(m_sensor_result_buffer);
+
+    // Contact events, after the collision list so the systems can read the collisions of the events
+    if( m_contact_events_enabled )
+    {
+        m_contact_tracker.update(m_collision_result_buffer);
+        const DotContactEvents& contact_events = m_contact_tracker.get_events();
+        for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_system_ptrs) system->on_contact_events(contact_events, m_collision_result_buffer);
+        for(const std::shared_ptr<DotSystemInterface>& system: m_low_resolution_body_system_ptrs) system->on_contact_events(contact_events, m_collision_result_buffer);
+        for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_system_ptrs) system->on_contact_events(contact_events, m_collision_result_buffer);
+        for(const std::shared_ptr<DotSystemInterface>& system: m_high_resolution_body_system_ptrs) system->on_contact_events(contact_events, m_collision_result_buffer);
+    }
+
+    // low resolutionsystem cleaning
     for(size_t i_p_1 = m_low_resolution_system_ptrs.size(); i_p_1 > 0; i_p_1--)
     {
         const size_t i = i_p_1  - 1;
         if(m_low_resolution_system_ptrs[i]->is_destroyed())
         {
+            m_low_resolution_system_ptrs[i]->on_unregister();
             std::swap(m_low_resolution_system_ptrs[i], m_low_resolution_system_ptrs.back());
             m_low_resolution_system_ptrs.pop_back();
+            m_collision_channels_changed = true;
+            m_system_graph_changed = true;
+        }
+    }
+    for(size_t i_p_1 = m_low_resolution_body_system_ptrs.size(); i_p_1 > 0; i_p_1--)
+    {
+        const size_t i = i_p_1  - 1;
+        if(m_low_resolution_body_system_ptrs[i]->is_destroyed())
+        {
+            m_low_resolution_body_system_ptrs[i]->on_unregister();
+            std::swap(m_low_resolution_body_system_ptrs[i], m_low_resolution_body_system_ptrs.back());
+            m_low_resolution_body_system_ptrs.pop_back();
+            m_collision_channels_changed = true;
         }
-        else m_low_resolution_system_ptrs[i]->apply(delta_t);
     }
 
     // high resolutionsystem cleaning
@@ -126,41 +466,191 @@ void DotEngine::update(const float delta_t, const size_t high_resolution_multipl
         const size_t i = i_p_1  - 1;
         if(m_high_resolution_system_ptrs[i]->is_destroyed())
         {
+            m_high_resolution_system_ptrs[i]->on_unregister();
             std::swap(m_high_resolution_system_ptrs[i], m_high_resolution_system_ptrs.back());
             m_high_resolution_system_ptrs.pop_back();
+            m_collision_channels_changed = true;
+            m_system_graph_changed = true;
+        }
+    }
+    for(size_t i_p_1 = m_high_resolution_body_system_ptrs.size(); i_p_1 > 0; i_p_1--)
+    {
+        const size_t i = i_p_1  - 1;
+        if(m_high_resolution_body_system_ptrs[i]->is_destroyed())
+        {
+            m_high_resolution_body_system_ptrs[i]->on_unregister();
+            std::swap(m_high_resolution_body_system_ptrs[i], m_high_resolution_body_system_ptrs.back());
+            m_high_resolution_body_system_ptrs.pop_back();
+            m_collision_channels_changed = true;
         }
     }
 
-    // Body on_low_resolution_loop_end
-    m_multi_thread_helper.body_on_low_resolution_loop_end(delta_t);
+    // Dependency graph of the systems, rebuilt when bodies or systems change
+    if( m_system_graph_changed )
+    {
+        m_low_resolution_system_graph.build(m_low_resolution_system_ptrs, true);
+        m_high_resolution_system_graph.build(m_high_resolution_system_ptrs);
+        m_system_graph_changed = false;
+    }
 
-    // High resolution loop
+    // low resolution body pass systems, before the graph so systems reading the accumulated forces see them
+    if( !m_low_resolution_body_system_ptrs.empty() )
+    {
+        prepare_body_pass(m_low_resolution_body_system_ptrs, delta_t);
+        m_multi_thread_helper.body_low_resolution_system_apply(delta_t);
+    }
+
+    // low resolution system apply
+    m_low_resolution_system_graph.apply(m_multi_thread_helper, delta_t);
+
+    // Number of high resolution steps, the contact list is known at this point
+    const size_t high_resolution_multiplier = m_adaptive_high_resolution ? compute_adaptive_high_resolution_multiplier(delta_t, max_high_resolution_multiplier) : max_high_resolution_multiplier;
+    m_last_high_resolution_multiplier = high_resolution_multiplier;
+
+    if( high_resolution_multiplier == 0 )
+    {
+        m_multi_thread_helper.body_on_low_resolution_loop_end(delta_t);
+        return;
+    }
+
+    // Prepared once for the first step, the single step of the multi rate and the first step of the other bodies
+    // start from the same state of the bodies
     const float delta_t_high_resolution = delta_t/high_resolution_multiplier;
-    for(size_t itt = 0 ; itt < high_resolution_multiplier; itt++)
+    prepare_body_pass(m_high_resolution_body_system_ptrs, delta_t_high_resolution);
+
+    // Bodies out of the high resolution systems reach the end of delta_t in one step
+    const std::vector<size_t>* high_resolution_body_ids = nullptr;
+    if( m_multi_rate_high_resolution && high_resolution_multiplier > 1 && split_high_resolution_bodies() )
     {
+        high_resolution_body_ids = &m_high_resolution_body_ids;
+        m_multi_thread_helper.body_on_low_resolution_loop_end_high_resolution_loop_start_end(delta_t, &m_low_resolution_body_ids);
+    }
 
-        // Body on_high_resolution_loop_start
-        //for(const std::shared_ptr<DotBodyInterface>& body_ptr : m_body_ptrs)
-        //{
-        //    body_ptr->on_high_resolution_loop_start(delta_t_high_resolution);
-        //}
-        m_multi_thread_helper.body_on_high_resolution_loop_start(delta_t_high_resolution);
+    // Body on_low_resolution_loop_end fused with the first on_high_resolution_loop_start
+    m_multi_thread_helper.body_on_low_resolution_loop_end_high_resolution_loop_start(delta_t, delta_t_high_resolution, high_resolution_body_ids);
 
+    // High resolution loop
+    for(size_t itt = 0 ; itt < high_resolution_multiplier; itt++)
+    {
         // high resolutionsystem apply
-        for(const std::shared_ptr<DotSystemInterface>& system_ptr : m_high_resolution_system_ptrs)
+        m_high_resolution_system_graph.apply(m_multi_thread_helper, delta_t_high_resolution);
+
+        // Body on_high_resolution_loop_end, fused with the on_high_resolution_loop_start of the next step
+        if( itt + 1 < high_resolution_multiplier )
         {
-            system_ptr->apply(delta_t_high_resolution);
+            prepare_body_pass(m_high_resolution_body_system_ptrs, delta_t_high_resolution);
+            m_multi_thread_helper.body_on_high_resolution_loop_end_start(delta_t_high_resolution, high_resolution_body_ids);
         }
+        else m_multi_thread_helper.body_on_high_resolution_loop_end(delta_t_high_resolution, high_resolution_body_ids);
+    }
+}
+void DotEngine::update_spatial_index()
+{
+    if( m_spatial_index_valid ) return;
+
+    m_spatial_index.clear();
+    m_spatial_index_body_ids.clear();
+    const size_t nbr_body = m_body_ptrs.size();
+    for(size_t i = 0; i < nbr_body; i++)
+    {
+        const std::shared_ptr<DotBodyInterface>& body_ptr = m_body_ptrs[i];
+        if( body_ptr->is_destroyed() ) continue;
+        if( body_ptr->get_shape_type() == SHAPE_CIRCLE ) m_spatial_index.add_circle(body_ptr->get_position(), body_ptr->get_size());
+        else m_spatial_index.add_bounds(body_ptr->get_position(), body_ptr->get_bound_half_extent());
+        m_spatial_index_body_ids.push_back(i);
+    }
+    m_spatial_index.build();
+    m_spatial_index_valid = true;
+}
 
-        // Body on_high_resolution_loop_end
-        //for(const std::shared_ptr<DotBodyInterface>& body_ptr : m_body_ptrs)
-        //{
-        //    body_ptr->on_high_resolution_loop_end(delta_t_high_resolution);
-        //}
-        m_multi_thread_helper.body_on_high_resolution_loop_end(delta_t_high_resolution);
+float DotEngine::get_spatial_shape_distance(const size_t circle_id, const Float2d& point) const
+{
+    const DotBodyInterface* const body_ptr = m_body_ptrs[m_spatial_index_body_ids[circle_id]].get();
+    Float2d normal;
+    return body_ptr->get_shape_core().get_point_distance(point, normal) - body_ptr->get_size();
+}
+
+bool DotEngine::spatial_shape_raycast(const size_t circle_id, const Float2d& start, const Float2d& direction, float& fraction, Float2d& normal) const
+{
+    const DotBodyInterface* const body_ptr = m_body_ptrs[m_spatial_index_body_ids[circle_id]].get();
+    return body_ptr->get_shape_core().raycast(start, direction, body_ptr->get_size(), fraction, normal);
+}
+
+void DotEngine::run_spatial_queries(const size_t nbr_query, const std::function<void(const DotThreadTask&)>& function)
+{
+    if( nbr_query < SPATIAL_QUERY_MULTITHREAD_MINIMUM_BATCH )
+    {
+        DotThreadTask task;
+        task.id_start = 0;
+        task.id_size = nbr_query;
+        task.dt = 0.0;
+        task.high_resolution_dt = 0.0;
+        task.task_id = DotThreadTaskId::CUSTOM;
+        function(task);
+        return;
     }
 
-    // Sleep threads from multithreads helper
-    m_multi_thread_helper.sleep();
+    m_multi_thread_helper.custom_function(0.0, nbr_query, &function);
+}
 
-}
\ No newline at end of file
+void DotEngine::query_radius(std::span<DotRadiusQuery> queries)
+{
+    update_spatial_index();
+    const std::function<void(const DotThreadTask&)> function = [this, queries](const DotThreadTask& task){
+        const size_t query_end = task.id_start + task.id_size;
+        for(size_t i = task.id_start; i < query_end; i++)
+        {
+            DotRadiusQuery& query = queries[i];
+            query.body_nbr = 0;
+            m_spatial_index.for_each_overlap(query.center, query.radius,
+                [this, &query](const size_t circle_id){ return m_body_ptrs[m_spatial_index_body_ids[circle_id]].get() != query.ignored_body_ptr; },
+                [this](const size_t circle_id, const Float2d& point){ return get_spatial_shape_distance(circle_id, point); },
+                [this, &query](const size_t circle_id){
+                    if( query.body_nbr < query.body_ids.size() ) query.body_ids[query.body_nbr] = m_spatial_index_body_ids[circle_id];
+                    query.body_nbr += 1;
+                }
+            );
+        }
+    };
+    run_spatial_queries(queries.size(), function);
+}
+
+void DotEngine::query_nearest(std::span<DotNearestQuery> queries)
+{
+    update_spatial_index();
+    const std::function<void(const DotThreadTask&)> function = [this, queries](const DotThreadTask& task){
+        const size_t query_end = task.id_start + task.id_size;
+        for(size_t i = task.id_start; i < query_end; i++)
+        {
+            DotNearestQuery& query = queries[i];
+            const size_t max_nbr = std::min(query.body_ids.size(), query.distances.size());
+            query.body_nbr = m_spatial_index.find_nearest(query.position, query.max_distance, max_nbr,
+                [this, &query](const size_t circle_id){ return m_body_ptrs[m_spatial_index_body_ids[circle_id]].get() != query.ignored_body_ptr; },
+                [this](const size_t circle_id, const Float2d& point){ return get_spatial_shape_distance(circle_id, point); },
+                query.body_ids.data(), query.distances.data()
+            );
+            for(size_t k = 0; k < query.body_nbr; k++) query.body_ids[k] = m_spatial_index_body_ids[query.body_ids[k]];
+        }
+    };
+    run_spatial_queries(queries.size(), function);
+}
+
+void DotEngine::raycast(std::span<DotRaycastQuery> queries)
+{
+    update_spatial_index();
+    const std::function<void(const DotThreadTask&)> function = [this, queries](const DotThreadTask& task){
+        const size_t query_end = task.id_start + task.id_size;
+        for(size_t i = task.id_start; i < query_end; i++)
+        {
+            DotRaycastQuery& query = queries[i];
+            size_t hit_circle_id = 0;
+            query.has_hit = m_spatial_index.raycast(query.start, query.end,
+                [this, &query](const size_t circle_id){ return m_body_ptrs[m_spatial_index_body_ids[circle_id]].get() != query.ignored_body_ptr; },
+                [this](const size_t circle_id, const Float2d& start, const Float2d& direction, float& fraction, Float2d& normal){ return spatial_shape_raycast(circle_id, start, direction, fraction, normal); },
+                hit_circle_id, query.fraction, query.normal
+            );
+            query.body_id = query.has_hit ? m_spatial_index_body_ids[hit_circle_id] : 0;
+        }
+    };
+    run_spatial_queries(queries.size(), function);
+}
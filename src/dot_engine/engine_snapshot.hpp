@@ -0,0 +1,78 @@
+#include "./engine.hpp"
+#include <unordered_map>
+
+#pragma once
+
+struct DotBodySnapshot
+{
+    Float2d position;
+    Float2d speed;
+    float size;
+};
+
+// Copy of the body states of an engine after a step, readers use it without locking the engine
+class DotEngineSnapshot
+{
+    private:
+    std::vector<DotBodySnapshot> m_bodies;
+    std::vector<const DotBodyInterface*> m_body_ptrs;
+    std::unordered_map<const DotBodyInterface*, size_t> m_body_ids;
+    // Body list version of the engine when m_body_ptrs was copied, the body ids are rebuilt only when it change
+    size_t m_body_list_version;
+    bool m_is_valid;
+    size_t m_step_nbr;
+
+    public:
+    DotEngineSnapshot():
+    m_body_list_version(0),
+    m_is_valid(false),
+    m_step_nbr(0)
+    {}
+
+    void capture(const DotEngine& engine, const size_t step_nbr);
+
+    // False until the first capture
+    bool is_valid() const { return m_is_valid; }
+    size_t get_step_nbr() const { return m_step_nbr; }
+
+    size_t get_body_nbr() const { return m_bodies.size(); }
+    const std::vector<DotBodySnapshot>& get_bodies() const { return m_bodies; }
+    const std::vector<const DotBodyInterface*>& get_body_ptrs() const { return m_body_ptrs; }
+
+    // Return nullptr if the body was not in the engine at the capture
+    const DotBodySnapshot* get_body(const DotBodyInterface* const body_ptr) const {
+        const std::unordered_map<const DotBodyInterface*, size_t>::const_iterator it = m_body_ids.find(body_ptr);
+        return it != m_body_ids.end() ? &m_bodies[it->second] : nullptr;
+    }
+};
+
+void DotEngineSnapshot::capture(const DotEngine& engine, const size_t step_nbr)
+{
+    const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs = engine.get_bodies();
+    const size_t nbr_body = body_ptrs.size();
+
+    if( !m_is_valid || m_body_list_version != engine.get_body_list_version() )
+    {
+        m_body_ptrs.resize(nbr_body);
+        m_body_ids.clear();
+        for(size_t i = 0; i < nbr_body; i++)
+        {
+            m_body_ptrs[i] = body_ptrs[i].get();
+            m_body_ids.emplace(m_body_ptrs[i], i);
+        }
+        m_body_list_version = engine.get_body_list_version();
+    }
+
+    m_bodies.resize(nbr_body);
+    for(size_t i = 0; i < nbr_body; i++)
+    {
+        const DotBodyInterface* const body_ptr = body_ptrs[i].get();
+        DotBodySnapshot& body_snapshot = m_bodies[i];
+        body_snapshot.position = body_ptr->get_position();
+        body_snapshot.speed = body_ptr->get_speed();
+        body_snapshot.size = body_ptr->get_size();
+    }
+
+    m_step_nbr = step_nbr;
+    m_is_valid = true;
+}
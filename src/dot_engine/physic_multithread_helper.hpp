@@ -1,20 +1,26 @@
 #include "./system_interface.hpp"
+#include "./physic_thread_pool.hpp"
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <functional>
 #include <iostream>
+#include <algorithm>
 #pragma once
 
 enum DotThreadTaskId {
     NONE,
-    KILL,
     CUSTOM,
     BODY_ON_HIGH_RESOLUTION_LOOP_END,
     BODY_ON_HIGH_RESOLUTION_LOOP_START,
     BODY_ON_LOW_RESOLUTION_LOOP_END,
     BODY_ON_LOW_RESOLUTION_LOOP_START,
-    BODY_HAS_COLLISION
+    BODY_ON_HIGH_RESOLUTION_LOOP_END_START,
+    BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START,
+    BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START_END,
+    BODY_LOW_RESOLUTION_SYSTEM_APPLY,
+    BODY_HAS_COLLISION,
+    BODY_HAS_COLLISION_MERGE
 };
 
 struct DotThreadTask
@@ -22,90 +28,105 @@ struct DotThreadTask
     size_t id_start;
     size_t id_size;
     float dt;
+    float high_resolution_dt;
     uint8_t task_id;
 };
 
-class DotPhysicMultithreadHelper
+// Per engine tasks and buffers, the tasks are executed by a thread pool that can be shared between engines
+class DotPhysicMultithreadHelper : public DotPhysicThreadPoolJob
 {
     private:
-    std::vector<std::thread> m_threads;
+    std::shared_ptr<DotPhysicThreadPool> m_thread_pool_ptr;
     std::vector<DotThreadTask> m_threads_tasks;
-    std::vector<std::unique_ptr<std::atomic_flag>> m_worker_wait_flags;
-    std::atomic_flag m_awake_flag;
-
-    std::atomic_uint8_t m_nbr_task_to_finish;
 
     std::vector<std::shared_ptr<DotBodyInterface>>& m_body_ptrs_ref;
     std::vector<std::shared_ptr<DotSystemInterface>>& m_low_resolution_system_ptrs_ref;
+    std::vector<std::shared_ptr<DotSystemInterface>>& m_low_resolution_body_system_ptrs_ref;
     std::vector<std::shared_ptr<DotSystemInterface>>& m_high_resolution_system_ptrs_ref;
+    std::vector<std::shared_ptr<DotSystemInterface>>& m_high_resolution_body_system_ptrs_ref;
     std::vector<std::vector<size_t>>& m_collision_sort_result_buffer_ref;
+    // Motion of the tick of every body, empty when no body has continuous collision
+    std::vector<Float2d>& m_body_sweeps_ref;
     std::vector<std::vector<DotCollisionInfo>> m_collision_result_buffer_unfused;
     std::vector<DotCollisionInfo>&    m_collision_result_buffer_ref;
+    std::vector<size_t> m_collision_result_offsets;
+    // Overlaps of the sensor bodies, kept out of the collision list
+    std::vector<std::vector<DotCollisionInfo>> m_sensor_result_buffer_unfused;
+    std::vector<DotCollisionInfo>&    m_sensor_result_buffer_ref;
+    std::vector<size_t> m_sensor_result_offsets;
+    // Filter of each collision channel, each thread append the matching collisions to its own channel buffers
+    const std::vector<DotCollisionFilter>& m_collision_filters_ref;
+    std::vector<std::vector<std::vector<DotCollisionInfo>>> m_collision_channel_buffers_unfused;
+    std::vector<std::vector<DotCollisionInfo>>& m_collision_channel_buffers_ref;
+    std::vector<std::vector<size_t>> m_collision_channel_offsets;
     const std::function<void(const DotThreadTask&)>*  m_custom_function_ptr;
-    
+    // Body ids of the running body task, all the bodies when null
+    const std::vector<size_t>* m_task_body_ids_ptr;
 
     const uint8_t m_nbr_thread;
 
-    void worker_loop(const size_t thread_id);
     void task_BODY_HAS_COLLISION(const DotThreadTask& task, const uint8_t thread_id);
+    void body_high_resolution_loop_start(const size_t body_id, const float dt);
+    size_t task_body_id(const size_t i) const { return m_task_body_ids_ptr ? (*m_task_body_ids_ptr)[i] : i; }
+    void populate_body_task_and_wait(const float dt, const DotThreadTaskId task_id, const std::vector<size_t>* body_ids, const float high_resolution_dt = 0.0)
+    {
+        m_task_body_ids_ptr = body_ids;
+        populate_task_and_wait(dt, body_ids ? body_ids->size() : m_body_ptrs_ref.size(), task_id, high_resolution_dt);
+    }
+    void task_BODY_HAS_COLLISION_MERGE(const DotThreadTask& task, const uint8_t thread_id);
 
     public:
     DotPhysicMultithreadHelper(
         std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs_ref,
         std::vector<std::shared_ptr<DotSystemInterface>>& low_resolution_system_ptrs_ref,
+        std::vector<std::shared_ptr<DotSystemInterface>>& low_resolution_body_system_ptrs_ref,
         std::vector<std::shared_ptr<DotSystemInterface>>& high_resolution_system_ptrs_ref,
+        std::vector<std::shared_ptr<DotSystemInterface>>& high_resolution_body_system_ptrs_ref,
         std::vector<std::vector<size_t>>& collision_sort_result_buffer_ref,
+        std::vector<Float2d>& body_sweeps_ref,
         std::vector<DotCollisionInfo>&    collision_result_buffer_ref,
-        const uint8_t nbr_thread
+        const std::vector<DotCollisionFilter>& collision_filters_ref,
+        std::vector<std::vector<DotCollisionInfo>>& collision_channel_buffers_ref,
+        std::vector<DotCollisionInfo>&    sensor_result_buffer_ref,
+        std::shared_ptr<DotPhysicThreadPool> thread_pool_ptr
     ):
-    m_awake_flag(),
+    m_thread_pool_ptr(thread_pool_ptr ? std::move(thread_pool_ptr) : std::make_shared<DotPhysicThreadPool>()),
     m_body_ptrs_ref(body_ptrs_ref),
     m_low_resolution_system_ptrs_ref(low_resolution_system_ptrs_ref),
+    m_low_resolution_body_system_ptrs_ref(low_resolution_body_system_ptrs_ref),
     m_high_resolution_system_ptrs_ref(high_resolution_system_ptrs_ref),
+    m_high_resolution_body_system_ptrs_ref(high_resolution_body_system_ptrs_ref),
     m_collision_sort_result_buffer_ref(collision_sort_result_buffer_ref),
+    m_body_sweeps_ref(body_sweeps_ref),
     m_collision_result_buffer_ref(collision_result_buffer_ref),
-    m_nbr_thread(nbr_thread)
+    m_sensor_result_buffer_ref(sensor_result_buffer_ref),
+    m_collision_filters_ref(collision_filters_ref),
+    m_collision_channel_buffers_ref(collision_channel_buffers_ref),
+    m_custom_function_ptr(nullptr),
+    m_task_body_ids_ptr(nullptr),
+    m_nbr_thread(std::clamp<size_t>(m_thread_pool_ptr->get_thread_nbr(), 1, UINT8_MAX))
     {
-        m_awake_flag.clear(std::memory_order::release);
-        for(uint8_t i = 0; i < nbr_thread; i++)
+        for(uint8_t i = 0; i < m_nbr_thread; i++)
         {
             m_threads_tasks.emplace_back();
-            m_worker_wait_flags.emplace_back(std::make_unique<std::atomic_flag>());
-            m_worker_wait_flags.back()->test_and_set();
             m_collision_result_buffer_unfused.emplace_back();
+            m_collision_result_offsets.emplace_back(0);
+            m_sensor_result_buffer_unfused.emplace_back();
+            m_sensor_result_offsets.emplace_back(0);
+            m_collision_channel_buffers_unfused.emplace_back();
+            m_collision_channel_offsets.emplace_back();
         }
-
-        for(uint8_t i = 0; i < nbr_thread; i++)
-        {
-            m_threads.emplace_back(std::thread(&DotPhysicMultithreadHelper::worker_loop, this, i));
-        }
-
     }
 
-    ~DotPhysicMultithreadHelper()
-    {
-        awake();
-        for(uint8_t i = 0; i < m_nbr_thread; i++)
-        {
-            DotThreadTask& task = m_threads_tasks[i];
-            task.task_id = DotThreadTaskId::KILL;
-            m_worker_wait_flags[i]->clear(std::memory_order::release);
-        }
-        for( std::thread& m_thread : m_threads )
-        {
-            if(m_thread.joinable())m_thread.join();
-        }
-    }
+    DotPhysicMultithreadHelper(const DotPhysicMultithreadHelper&) = delete;
 
-    void awake(){
-        m_awake_flag.test_and_set(std::memory_order::release); 
-        m_awake_flag.notify_all();
-    }
-    void sleep(){m_awake_flag.clear(std::memory_order::release);}
+    const std::shared_ptr<DotPhysicThreadPool>& get_thread_pool() const { return m_thread_pool_ptr; }
+
+    // Execute the task of a slot, slot id index the per slot buffers of this helper
+    virtual void execute_slot(const size_t slot);
 
-    void populate_task_and_wait(const float dt, const size_t size, const DotThreadTaskId task_id)
+    void populate_task_and_wait(const float dt, const size_t size, const DotThreadTaskId task_id, const float high_resolution_dt = 0.0)
     {
-        m_nbr_task_to_finish = m_nbr_thread;
         const size_t id_aug_per_thread = (size/m_nbr_thread)+1;
         size_t id_counter = 0;
         
@@ -123,15 +144,14 @@ class DotPhysicMultithreadHelper
             {
                 task.task_id = task_id;
                 task.dt = dt;
+                task.high_resolution_dt = high_resolution_dt;
                 task.id_start = id_counter;
                 task.id_size = task_size;
                 id_counter += task_size;
             }
-            m_worker_wait_flags[i]->clear(std::memory_order::release);
         }
 
-        uint8_t remaining_tasks = m_nbr_thread;
-        while( m_nbr_task_to_finish != 0);
+        m_thread_pool_ptr->run(*this, m_nbr_thread);
 
     }
 
@@ -145,7 +165,6 @@ class DotPhysicMultithreadHelper
             total_couple_size += collision_result.size();
         }
 
-        m_nbr_task_to_finish = m_nbr_thread;
         const size_t id_aug_per_thread = (total_couple_size/m_nbr_thread)+1;
         size_t id_counter = 0;
         
@@ -172,146 +191,318 @@ class DotPhysicMultithreadHelper
                 task.id_size = task_size;
                 id_counter += task_size;
             }
-            m_worker_wait_flags[i]->clear(std::memory_order::release);
         }
 
-        uint8_t remaining_tasks = m_nbr_thread;
-        while( m_nbr_task_to_finish != 0);
+        m_thread_pool_ptr->run(*this, m_nbr_thread);
 
     }
 
+    void populate_has_collision_merge_task_and_wait()
+    {
+        // Prefix sum over the thread results, each thread copy its own result at its offset
+        size_t total_size = 0;
+        for(size_t i = 0 ; i < m_nbr_thread; i++)
+        {
+            m_collision_result_offsets[i] = total_size;
+            total_size += m_collision_result_buffer_unfused[i].size();
+        }
+        m_collision_result_buffer_ref.resize(total_size);
+
+        size_t sensor_size = 0;
+        for(size_t i = 0 ; i < m_nbr_thread; i++)
+        {
+            m_sensor_result_offsets[i] = sensor_size;
+            sensor_size += m_sensor_result_buffer_unfused[i].size();
+        }
+        m_sensor_result_buffer_ref.resize(sensor_size);
+
+        // Same for every channel, a channel is a subset of the full list so it is empty when the list is empty
+        const size_t nbr_channel = m_collision_filters_ref.size();
+        for(size_t channel_id = 0; channel_id < nbr_channel; channel_id++)
+        {
+            size_t channel_size = 0;
+            for(size_t i = 0 ; i < m_nbr_thread; i++)
+            {
+                m_collision_channel_offsets[i][channel_id] = channel_size;
+                channel_size += m_collision_channel_buffers_unfused[i][channel_id].size();
+            }
+            m_collision_channel_buffers_ref[channel_id].resize(channel_size);
+        }
+        if( total_size == 0 && sensor_size == 0 ) return;
+
+        for(size_t i = 0 ; i < m_nbr_thread; i++)
+        {
+            DotThreadTask& task = m_threads_tasks[i];
+            const size_t task_size = m_collision_result_buffer_unfused[i].size();
+            if( task_size == 0 && m_sensor_result_buffer_unfused[i].empty() )
+            {
+                task.task_id = DotThreadTaskId::NONE;
+            }
+            else
+            {
+                task.task_id = DotThreadTaskId::BODY_HAS_COLLISION_MERGE;
+                task.id_start = m_collision_result_offsets[i];
+                task.id_size = task_size;
+            }
+        }
+
+        m_thread_pool_ptr->run(*this, m_nbr_thread);
+    }
+
     void custom_function(const float dt, const size_t size, const std::function<void(const DotThreadTask&)>*  custom_function_ptr)
     {
         m_custom_function_ptr = custom_function_ptr;
         populate_task_and_wait(dt, size, DotThreadTaskId::CUSTOM);
     }
 
-    void body_on_high_resolution_loop_start(const float dt)
+    // Body tasks run on the bodies of body_ids when given, else on every body
+    void body_on_high_resolution_loop_start(const float dt, const std::vector<size_t>* body_ids = nullptr)
     {
-        populate_task_and_wait(dt, m_body_ptrs_ref.size(), DotThreadTaskId::BODY_ON_HIGH_RESOLUTION_LOOP_START);
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_HIGH_RESOLUTION_LOOP_START, body_ids);
     }
 
-    void body_on_high_resolution_loop_end(const float dt)
+    void body_on_high_resolution_loop_end(const float dt, const std::vector<size_t>* body_ids = nullptr)
     {
-        populate_task_and_wait(dt, m_body_ptrs_ref.size(), DotThreadTaskId::BODY_ON_HIGH_RESOLUTION_LOOP_END);
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_HIGH_RESOLUTION_LOOP_END, body_ids);
     }
 
-    void body_on_low_resolution_loop_start(const float dt)
+    // on_high_resolution_loop_end of a step and on_high_resolution_loop_start of the next step in one pass
+    void body_on_high_resolution_loop_end_start(const float dt, const std::vector<size_t>* body_ids = nullptr)
     {
-        populate_task_and_wait(dt, m_body_ptrs_ref.size(), DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_START);
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_HIGH_RESOLUTION_LOOP_END_START, body_ids);
     }
 
-    void body_on_low_resolution_loop_end(const float dt)
+    // on_low_resolution_loop_end and the first on_high_resolution_loop_start in one pass
+    void body_on_low_resolution_loop_end_high_resolution_loop_start(const float dt, const float high_resolution_dt, const std::vector<size_t>* body_ids = nullptr)
     {
-        populate_task_and_wait(dt, m_body_ptrs_ref.size(), DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_END);
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START, body_ids, high_resolution_dt);
+    }
+
+    // on_low_resolution_loop_end and a single high resolution step of dt in one pass
+    void body_on_low_resolution_loop_end_high_resolution_loop_start_end(const float dt, const std::vector<size_t>* body_ids = nullptr)
+    {
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START_END, body_ids);
+    }
+
+    void body_on_low_resolution_loop_start(const float dt, const std::vector<size_t>* body_ids = nullptr)
+    {
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_START, body_ids);
+    }
+
+    void body_on_low_resolution_loop_end(const float dt, const std::vector<size_t>* body_ids = nullptr)
+    {
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_ON_LOW_RESOLUTION_LOOP_END, body_ids);
+    }
+
+    // Every low resolution body pass system on every body in one pass, each body is visited once for all of them
+    void body_low_resolution_system_apply(const float dt)
+    {
+        populate_body_task_and_wait(dt, DotThreadTaskId::BODY_LOW_RESOLUTION_SYSTEM_APPLY, nullptr);
     }
 
     void body_has_collision()
     {
-        m_collision_result_buffer_ref.clear();
         for(std::vector<DotCollisionInfo>& result_buffer: m_collision_result_buffer_unfused)result_buffer.clear();
-        populate_has_collision_task_and_wait();
-        for(std::vector<DotCollisionInfo>& result_buffer: m_collision_result_buffer_unfused)
+        for(std::vector<DotCollisionInfo>& result_buffer: m_sensor_result_buffer_unfused)result_buffer.clear();
+        const size_t nbr_channel = m_collision_filters_ref.size();
+        m_collision_channel_buffers_ref.resize(nbr_channel);
+        for(size_t i = 0 ; i < m_nbr_thread; i++)
         {
-            for(DotCollisionInfo& info: result_buffer) m_collision_result_buffer_ref.emplace_back(std::move(info));
+            m_collision_channel_buffers_unfused[i].resize(nbr_channel);
+            for(std::vector<DotCollisionInfo>& result_buffer: m_collision_channel_buffers_unfused[i])result_buffer.clear();
+            m_collision_channel_offsets[i].resize(nbr_channel);
         }
+        populate_has_collision_task_and_wait();
+        populate_has_collision_merge_task_and_wait();
     }
 };
 
 void DotPhysicMultithreadHelper::task_BODY_HAS_COLLISION(const DotThreadTask& task, const uint8_t thread_id)
 {
     std::vector<DotCollisionInfo>& collision_result_buffer = m_collision_result_buffer_unfused[thread_id];
+    std::vector<std::vector<DotCollisionInfo>>& collision_channel_buffers = m_collision_channel_buffers_unfused[thread_id];
+    std::vector<DotCollisionInfo>& sensor_result_buffer = m_sensor_result_buffer_unfused[thread_id];
+    const size_t nbr_channel = m_collision_filters_ref.size();
     const size_t end_excluded = task.id_size+task.id_start;
     for(size_t i = task.id_start; i < end_excluded; i++)
     {
         const std::vector<size_t>& collision_sort_result = m_collision_sort_result_buffer_ref[i];
         const size_t body_i_id = collision_sort_result[0];
         const std::shared_ptr<DotBodyInterface>& body_ptr_i = m_body_ptrs_ref[body_i_id];
+        const bool has_sweeps = !m_body_sweeps_ref.empty();
+        const bool is_continuous_i = has_sweeps && body_ptr_i->has_continuous_collision();
+        const bool is_sensor_i = body_ptr_i->is_sensor();
+        const bool is_compound_part_i = body_ptr_i->get_body_type_flags() & BODY_TYPE_COMPOUND_PART;
 
         const size_t nbr_m_collision_sort_result_buffer_sub_result = collision_sort_result.size();
         for(size_t j = 1; j < nbr_m_collision_sort_result_buffer_sub_result; j++)
         {
             const size_t body_j_id = collision_sort_result[j];
             const std::shared_ptr<DotBodyInterface>& body_ptr_j = m_body_ptrs_ref[body_j_id];
-            if( DotBodyInterface::hasCollision(body_ptr_i, body_ptr_j) )
+            // Sensors do not detect each other
+            if( is_sensor_i && body_ptr_j->is_sensor() ) continue;
+            // Parts of a same compound do not move relatively to each other
+            if( is_compound_part_i && body_ptr_j->get_compound_key() == body_ptr_i->get_compound_key() ) continue;
+            const bool is_continuous = is_continuous_i || (has_sweeps && body_ptr_j->has_continuous_collision());
+            float distance = 0.0;
+            bool is_touching = true;
+            const bool has_collision = is_continuous ?
+                DotBodyInterface::hasContinuousCollision(body_ptr_i, body_ptr_j, m_body_sweeps_ref[body_i_id], m_body_sweeps_ref[body_j_id]) :
+                DotBodyInterface::hasCollision(body_ptr_i, body_ptr_j, distance, is_touching);
+            if( has_collision )
             {
-                collision_result_buffer.emplace_back(body_ptr_i.get(), body_ptr_j.get());
+                if( is_continuous ) distance = DotBodyInterface::getContactDistance(body_ptr_i, body_ptr_j);
+                if( is_sensor_i || body_ptr_j->is_sensor() )
+                {
+                    sensor_result_buffer.emplace_back(body_ptr_i.get(), body_ptr_j.get(), body_i_id, body_j_id, distance, is_touching);
+                    continue;
+                }
+                collision_result_buffer.emplace_back(body_ptr_i.get(), body_ptr_j.get(), body_i_id, body_j_id, distance, is_touching);
+                const DotCollisionInfo& info = collision_result_buffer.back();
+                for(size_t channel_id = 0; channel_id < nbr_channel; channel_id++)
+                {
+                    if( m_collision_filters_ref[channel_id].match(info) ) collision_channel_buffers[channel_id].push_back(info);
+                }
             }
         }
     }
 }
 
-void DotPhysicMultithreadHelper::worker_loop(const size_t thread_id)
+void DotPhysicMultithreadHelper::task_BODY_HAS_COLLISION_MERGE(const DotThreadTask& task, const uint8_t thread_id)
+{
+    const std::vector<DotCollisionInfo>& collision_result_buffer = m_collision_result_buffer_unfused[thread_id];
+    std::copy(collision_result_buffer.begin(), collision_result_buffer.end(), m_collision_result_buffer_ref.begin() + task.id_start);
+
+    const std::vector<DotCollisionInfo>& sensor_result_buffer = m_sensor_result_buffer_unfused[thread_id];
+    std::copy(sensor_result_buffer.begin(), sensor_result_buffer.end(), m_sensor_result_buffer_ref.begin() + m_sensor_result_offsets[thread_id]);
+
+    const std::vector<std::vector<DotCollisionInfo>>& collision_channel_buffers = m_collision_channel_buffers_unfused[thread_id];
+    const size_t nbr_channel = collision_channel_buffers.size();
+    for(size_t channel_id = 0; channel_id < nbr_channel; channel_id++)
+    {
+        const std::vector<DotCollisionInfo>& channel_buffer = collision_channel_buffers[channel_id];
+        std::copy(channel_buffer.begin(), channel_buffer.end(), m_collision_channel_buffers_ref[channel_id].begin() + m_collision_channel_offsets[thread_id][channel_id]);
+    }
+}
+
+void DotPhysicMultithreadHelper::body_high_resolution_loop_start(const size_t body_id, const float dt)
 {
-    std::atomic_flag& worker_wait_flag = *m_worker_wait_flags[thread_id];
-    DotThreadTask& task = m_threads_tasks[thread_id];
-    bool continue_loop = true;
-    while(continue_loop)
+    m_body_ptrs_ref[body_id]->on_high_resolution_loop_start(dt);
+    for(const std::shared_ptr<DotSystemInterface>& system_ptr : m_high_resolution_body_system_ptrs_ref)
     {
-        while( worker_wait_flag.test(std::memory_order::acquire) )
+        system_ptr->apply_on_body(body_id, dt);
+    }
+}
+
+void DotPhysicMultithreadHelper::execute_slot(const size_t slot)
+{
+    const DotThreadTask& task = m_threads_tasks[slot];
+
+    switch(task.task_id) {
+    case NONE:
+        break;
+
+    case CUSTOM:
+        m_custom_function_ptr->operator()(task);
+        break;
+
+    case BODY_ON_HIGH_RESOLUTION_LOOP_START:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            m_awake_flag.wait(false);
+            body_high_resolution_loop_start(task_body_id(i), task.dt);
         }
-        worker_wait_flag.test_and_set(std::memory_order::release);
+        break;
+    }
 
-        switch(task.task_id) {
-        case NONE:
-            break;
+    case BODY_ON_HIGH_RESOLUTION_LOOP_END_START:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
+        {
+            const size_t body_id = task_body_id(i);
+            m_body_ptrs_ref[body_id]->on_high_resolution_loop_end(task.dt);
+            body_high_resolution_loop_start(body_id, task.dt);
+        }
+        break;
+    }
 
-        case KILL:
-            continue_loop = false;
-            break;
+    case BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
+        {
+            const size_t body_id = task_body_id(i);
+            m_body_ptrs_ref[body_id]->on_low_resolution_loop_end(task.dt);
+            body_high_resolution_loop_start(body_id, task.high_resolution_dt);
+        }
+        break;
+    }
 
-        case CUSTOM:
-            m_custom_function_ptr->operator()(task);
-            break;
+    case BODY_ON_LOW_RESOLUTION_LOOP_END_HIGH_RESOLUTION_LOOP_START_END:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
+        {
+            const size_t body_id = task_body_id(i);
+            const std::shared_ptr<DotBodyInterface>& body_ptr = m_body_ptrs_ref[body_id];
+            body_ptr->on_low_resolution_loop_end(task.dt);
+            body_high_resolution_loop_start(body_id, task.dt);
+            body_ptr->on_high_resolution_loop_end(task.dt);
+        }
+        break;
+    }
 
-        case BODY_ON_HIGH_RESOLUTION_LOOP_START:
+    case BODY_ON_HIGH_RESOLUTION_LOOP_END:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            const size_t end_excluded = task.id_size+task.id_start;
-            for(size_t i = task.id_start; i < end_excluded; i++)
-            {
-                m_body_ptrs_ref[i]->on_high_resolution_loop_start(task.dt);
-            }
-            break;
+            m_body_ptrs_ref[task_body_id(i)]->on_high_resolution_loop_end(task.dt);
         }
+        break;
+    }
 
-        case BODY_ON_HIGH_RESOLUTION_LOOP_END:
+    case BODY_ON_LOW_RESOLUTION_LOOP_END:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            const size_t end_excluded = task.id_size+task.id_start;
-            for(size_t i = task.id_start; i < end_excluded; i++)
-            {
-                m_body_ptrs_ref[i]->on_high_resolution_loop_end(task.dt);
-            }
-            break;
+            m_body_ptrs_ref[task_body_id(i)]->on_low_resolution_loop_end(task.dt);
         }
+        break;
+    }
 
-        case BODY_ON_LOW_RESOLUTION_LOOP_END:
+    case BODY_ON_LOW_RESOLUTION_LOOP_START:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            const size_t end_excluded = task.id_size+task.id_start;
-            for(size_t i = task.id_start; i < end_excluded; i++)
-            {
-                m_body_ptrs_ref[i]->on_low_resolution_loop_end(task.dt);
-            }
-            break;
+            m_body_ptrs_ref[task_body_id(i)]->on_low_resolution_loop_start(task.dt);
         }
+        break;
+    }
 
-        case BODY_ON_LOW_RESOLUTION_LOOP_START:
+    case BODY_LOW_RESOLUTION_SYSTEM_APPLY:
+    {
+        const size_t end_excluded = task.id_size+task.id_start;
+        for(size_t i = task.id_start; i < end_excluded; i++)
         {
-            const size_t end_excluded = task.id_size+task.id_start;
-            for(size_t i = task.id_start; i < end_excluded; i++)
+            for(const std::shared_ptr<DotSystemInterface>& system_ptr : m_low_resolution_body_system_ptrs_ref)
             {
-                m_body_ptrs_ref[i]->on_low_resolution_loop_start(task.dt);
+                system_ptr->apply_on_body(i, task.dt);
             }
-            break;
         }
+        break;
+    }
 
-        case BODY_HAS_COLLISION:
-            task_BODY_HAS_COLLISION(task, thread_id);
-            break;
-        }
+    case BODY_HAS_COLLISION:
+        task_BODY_HAS_COLLISION(task, slot);
+        break;
 
-        m_nbr_task_to_finish -= 1;
+    case BODY_HAS_COLLISION_MERGE:
+        task_BODY_HAS_COLLISION_MERGE(task, slot);
+        break;
     }
-
 }
\ No newline at end of file
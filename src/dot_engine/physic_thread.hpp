@@ -1,4 +1,6 @@
 #include "./engine.hpp"
+#include "./engine_snapshot.hpp"
+#include "./utils/triple_buffer.hpp"
 
 #include <chrono>
 #include <atomic>
@@ -18,18 +20,40 @@ class PhysicThread
     uint8_t m_forces_resolution_multiplier;
     std::thread m_physic_thread;
 
+    // Fixed step accumulator, time not yet simulated
+    std::chrono::steady_clock::time_point m_last_loop_time;
+    std::chrono::steady_clock::duration m_accumulator;
+    uint8_t m_max_catch_up_step;
+    std::atomic<float> m_interpolation_alpha;
+    std::atomic_size_t m_dropped_step_nbr;
+
+    // Body states published after each step for the reader thread
+    DotTripleBuffer<DotEngineSnapshot> m_snapshots;
+    std::atomic_bool m_snapshot_enabled;
+    size_t m_step_nbr;
+
     void physic_loop(){
+        m_last_loop_time = std::chrono::steady_clock::now();
+        m_accumulator = std::chrono::steady_clock::duration::zero();
         while(!m_end) physic_loop_itt(); 
     };
-    virtual void physic_loop_itt();
+    void physic_loop_itt();
+    virtual void physic_step();
 
     public:
 
-    PhysicThread(const float dt_second = 0.01, const uint8_t forces_resolution_multiplier = 10)
-    :m_end(false),
+    PhysicThread(const float dt_second = 0.01, const uint8_t forces_resolution_multiplier = 10, std::shared_ptr<DotPhysicThreadPool> thread_pool_ptr = nullptr)
+    :m_engine(std::move(thread_pool_ptr)),
+    m_end(false),
     m_dt_second(dt_second),
     m_dt_microseconds( uint64_t(dt_second*1000000.0) ),
-    m_forces_resolution_multiplier(forces_resolution_multiplier)
+    m_forces_resolution_multiplier(forces_resolution_multiplier),
+    m_accumulator(std::chrono::steady_clock::duration::zero()),
+    m_max_catch_up_step(5),
+    m_interpolation_alpha(0.0),
+    m_dropped_step_nbr(0),
+    m_snapshot_enabled(false),
+    m_step_nbr(0)
     {}
 
     void start()
@@ -64,6 +88,26 @@ class PhysicThread
         m_forces_resolution_multiplier = forces_resolution_multiplier;
     }
 
+    uint8_t get_max_catch_up_step() const { return m_max_catch_up_step; }
+
+    // Maximum number of steps done in one wake when the physic is late, the time beyond is dropped, !!! LOCK BEFORE !!!
+    void set_max_catch_up_step(const uint8_t max_catch_up_step) {
+        m_max_catch_up_step = max_catch_up_step;
+    }
+
+    // Fraction of a step between the last simulated state and now, to interpolate between the last two states
+    float get_interpolation_alpha() const { return m_interpolation_alpha; }
+
+    // Number of steps dropped because the physic was too late to catch up
+    size_t get_dropped_step_nbr() const { return m_dropped_step_nbr; }
+
+    // Publish a snapshot of the bodies after each step
+    bool get_snapshot_enabled() const { return m_snapshot_enabled; }
+    void set_snapshot_enabled(const bool value) { m_snapshot_enabled = value; }
+
+    // Last published snapshot, wait free, only one thread may read the snapshots
+    const DotEngineSnapshot& read_snapshot() { return m_snapshots.read(); }
+
     void lock(){m_physic_lock.lock();}
     void unlock(){m_physic_lock.unlock();}
 
@@ -73,23 +117,43 @@ class PhysicThread
 
 };
 
-void PhysicThread::physic_loop_itt()
+void PhysicThread::physic_step()
 {
-    static std::chrono::microseconds physic_time = std::chrono::microseconds(0);
-    static const std::chrono::duration physic_epoch = std::chrono::system_clock::now().time_since_epoch();
-
-    // Update de la physique
     m_physic_lock.lock();
     m_engine.update(m_dt_second, m_forces_resolution_multiplier);
-    physic_time += m_dt_microseconds;
+    m_step_nbr += 1;
+    if( m_snapshot_enabled )
+    {
+        m_snapshots.get_write_buffer().capture(m_engine, m_step_nbr);
+        m_snapshots.publish();
+    }
     m_physic_lock.unlock();
+}
 
-    // Sleep if we are too fast
-    const std::chrono::duration now = std::chrono::system_clock::now().time_since_epoch();
-    if( physic_time.count() > std::chrono::duration_cast<std::chrono::microseconds>(now-physic_epoch).count())
+void PhysicThread::physic_loop_itt()
+{
+    const std::chrono::steady_clock::duration dt = m_dt_microseconds;
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    m_accumulator += now - m_last_loop_time;
+    m_last_loop_time = now;
+
+    // Spiral of death protection, the time that can not be caught up is dropped
+    const std::chrono::steady_clock::duration max_accumulator = dt * std::max<size_t>(m_max_catch_up_step, 1);
+    if( m_accumulator > max_accumulator )
+    {
+        m_dropped_step_nbr += (m_accumulator - max_accumulator) / dt;
+        m_accumulator = max_accumulator;
+    }
+
+    while( m_accumulator >= dt && !m_end )
     {
-        std::this_thread::sleep_for(m_dt_microseconds);
+        physic_step();
+        m_accumulator -= dt;
     }
+    m_interpolation_alpha = float(m_accumulator.count()) / float(dt.count());
+
+    // Sleep until the deadline of the next step
+    std::this_thread::sleep_until(m_last_loop_time + (dt - m_accumulator));
 }
 
 class MonitoredPysicThread : public PhysicThread
@@ -100,15 +164,17 @@ class MonitoredPysicThread : public PhysicThread
     float loop_time_second_sum;
     float physic_compute_time_second_sum;
     size_t loop_nbr;
+    std::chrono::steady_clock::time_point m_last_step_time;
 
-    virtual void physic_loop_itt();
+    virtual void physic_step();
 
     public:
-    MonitoredPysicThread(const float dt_second = 0.01, const uint8_t forces_resolution_multiplier = 10):
-    PhysicThread(dt_second, forces_resolution_multiplier),
+    MonitoredPysicThread(const float dt_second = 0.01, const uint8_t forces_resolution_multiplier = 10, std::shared_ptr<DotPhysicThreadPool> thread_pool_ptr = nullptr):
+    PhysicThread(dt_second, forces_resolution_multiplier, std::move(thread_pool_ptr)),
     loop_time_second_sum(0.0),
     physic_compute_time_second_sum(0.0),
-    loop_nbr(0)
+    loop_nbr(0),
+    m_last_step_time()
     {}
 
     float get_loop_time_second_sum()const{ 
@@ -120,7 +186,7 @@ class MonitoredPysicThread : public PhysicThread
 
     float get_loop_time_second_mean()const{ 
         m_data_lock.lock();
-        const float out = loop_time_second_sum / float(loop_nbr);
+        const float out = loop_nbr > 1 ? loop_time_second_sum / float(loop_nbr - 1) : 0.0;
         m_data_lock.unlock();
         return out;
     }
@@ -148,31 +214,17 @@ class MonitoredPysicThread : public PhysicThread
 
 };
 
-void MonitoredPysicThread::physic_loop_itt()
+void MonitoredPysicThread::physic_step()
 {
-    static std::chrono::microseconds physic_time = std::chrono::microseconds(0);
-    static const std::chrono::duration physic_epoch = std::chrono::system_clock::now().time_since_epoch();
-    const std::chrono::duration start_time = std::chrono::system_clock::now().time_since_epoch();
-
-    // Update de la physique
-    m_physic_lock.lock();
-    m_engine.update(m_dt_second, m_forces_resolution_multiplier);
-    physic_time += m_dt_microseconds;
-    m_physic_lock.unlock();
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    PhysicThread::physic_step();
+    const std::chrono::steady_clock::time_point post_physic = std::chrono::steady_clock::now();
 
-    // Sleep if we are too fast
-    const std::chrono::duration post_physic = std::chrono::system_clock::now().time_since_epoch();
-    if( physic_time.count() > std::chrono::duration_cast<std::chrono::microseconds>(post_physic-physic_epoch).count())
-    {
-        std::this_thread::sleep_for(m_dt_microseconds);
-    }
-    const std::chrono::duration post_sleep = std::chrono::system_clock::now().time_since_epoch();
-
-    // save data
+    // save data, the loop time is the time between two steps
     m_data_lock.lock();
-    loop_time_second_sum += float(std::chrono::duration_cast<std::chrono::microseconds>(post_sleep-start_time).count())/1000000.0;
-    physic_compute_time_second_sum += float(std::chrono::duration_cast<std::chrono::microseconds>(post_physic-start_time).count())/1000000.0;
+    if( loop_nbr > 0 ) loop_time_second_sum += std::chrono::duration<float>(start_time - m_last_step_time).count();
+    physic_compute_time_second_sum += std::chrono::duration<float>(post_physic - start_time).count();
     loop_nbr += 1;
-
+    m_last_step_time = start_time;
     m_data_lock.unlock();
-}
\ No newline at end of file
+}
@@ -0,0 +1,147 @@
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#pragma once
+
+constexpr size_t PHYSIC_THREAD_POOL_DEFAULT_THREAD_NBR = 8;
+// Time a worker without slot keeps polling the queue before parking, it covers the gap between the dispatches of a tick
+constexpr std::chrono::microseconds PHYSIC_THREAD_POOL_SPIN_DURATION(50);
+
+// Work split in slots, slots are executed by the pool workers and by the submitting thread
+class DotPhysicThreadPoolJob
+{
+    public:
+    std::atomic_size_t m_next_slot;
+    std::atomic_size_t m_nbr_slot_to_finish;
+    size_t m_nbr_slot;
+
+    DotPhysicThreadPoolJob():m_next_slot(0), m_nbr_slot_to_finish(0), m_nbr_slot(0){}
+    virtual ~DotPhysicThreadPoolJob(){}
+    virtual void execute_slot(const size_t slot) = 0;
+};
+
+// Worker threads shared by every DotEngine built on the pool, jobs of different engines are served in round robin
+class DotPhysicThreadPool
+{
+    private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_job_lock;
+    std::deque<DotPhysicThreadPoolJob*> m_jobs;
+    // Size of m_jobs, read without the lock by polling workers
+    std::atomic_size_t m_nbr_job;
+
+    // Workers park on it while the job queue is empty, so the serial parts of a tick cost no core
+    std::condition_variable m_job_condition;
+    // Guarded by m_job_lock
+    bool m_end;
+
+    void worker_loop();
+    // m_job_lock must be held
+    DotPhysicThreadPoolJob* take_slot(size_t& slot);
+
+    public:
+    DotPhysicThreadPool(const size_t nbr_thread = PHYSIC_THREAD_POOL_DEFAULT_THREAD_NBR):
+    m_nbr_job(0),
+    m_end(false)
+    {
+        for(size_t i = 0; i < nbr_thread; i++)
+        {
+            m_threads.emplace_back(std::thread(&DotPhysicThreadPool::worker_loop, this));
+        }
+    }
+
+    DotPhysicThreadPool(const DotPhysicThreadPool&) = delete;
+
+    ~DotPhysicThreadPool()
+    {
+        m_job_lock.lock();
+        m_end = true;
+        m_job_lock.unlock();
+        m_job_condition.notify_all();
+        for( std::thread& thread : m_threads )
+        {
+            if(thread.joinable()) thread.join();
+        }
+    }
+
+    size_t get_thread_nbr() const { return m_threads.size(); }
+
+    // Execute every slot of the job and return when they are all done, the calling thread execute slots too
+    void run(DotPhysicThreadPoolJob& job, const size_t nbr_slot);
+};
+
+void DotPhysicThreadPool::run(DotPhysicThreadPoolJob& job, const size_t nbr_slot)
+{
+    job.m_nbr_slot = nbr_slot;
+    job.m_nbr_slot_to_finish = nbr_slot;
+    job.m_next_slot = 0;
+
+    m_job_lock.lock();
+    m_jobs.push_back(&job);
+    m_nbr_job = m_jobs.size();
+    m_job_lock.unlock();
+    if( nbr_slot > 1 ) m_job_condition.notify_all();
+
+    // Help the workers with our own job
+    for(size_t slot = job.m_next_slot++; slot < nbr_slot; slot = job.m_next_slot++)
+    {
+        job.execute_slot(slot);
+        job.m_nbr_slot_to_finish -= 1;
+    }
+
+    // Only the slots already taken by workers are left
+    while( job.m_nbr_slot_to_finish != 0 ) std::this_thread::yield();
+
+    // The last slot may have been taken outside the queue lock
+    m_job_lock.lock();
+    const std::deque<DotPhysicThreadPoolJob*>::iterator job_it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+    if( job_it != m_jobs.end() ) m_jobs.erase(job_it);
+    m_nbr_job = m_jobs.size();
+    m_job_lock.unlock();
+}
+
+DotPhysicThreadPoolJob* DotPhysicThreadPool::take_slot(size_t& slot)
+{
+    while( !m_jobs.empty() )
+    {
+        DotPhysicThreadPoolJob* const job = m_jobs.front();
+        m_jobs.pop_front();
+        slot = job->m_next_slot++;
+        if( slot >= job->m_nbr_slot ) continue;
+
+        // Put the job at the end so the next slot goes to an other engine
+        if( slot + 1 < job->m_nbr_slot ) m_jobs.push_back(job);
+        m_nbr_job = m_jobs.size();
+        return job;
+    }
+    m_nbr_job = 0;
+    return nullptr;
+}
+
+void DotPhysicThreadPool::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(m_job_lock);
+    while( true )
+    {
+        m_job_condition.wait(lock, [this](){ return m_end || !m_jobs.empty(); });
+        if( m_end ) return;
+
+        size_t slot = 0;
+        DotPhysicThreadPoolJob* const job = take_slot(slot);
+        if( !job ) continue;
+
+        lock.unlock();
+        job->execute_slot(slot);
+        job->m_nbr_slot_to_finish -= 1;
+
+        // Poll a short time for the next dispatch before parking
+        const std::chrono::steady_clock::time_point spin_end = std::chrono::steady_clock::now() + PHYSIC_THREAD_POOL_SPIN_DURATION;
+        while( m_nbr_job == 0 && std::chrono::steady_clock::now() < spin_end ) std::this_thread::yield();
+        lock.lock();
+    }
+}
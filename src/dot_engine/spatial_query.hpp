@@ -0,0 +1,44 @@
+#include "./body_interface.hpp"
+#include <span>
+
+#pragma once
+
+// Queries are run in batch by DotEngine, results are written in spans preallocated by the caller
+// Body ids index DotEngine::get_bodies() and stay valid until the next update
+
+// Bodies overlapping a circle
+struct DotRadiusQuery
+{
+    Float2d center;
+    float radius;
+    // Body not reported, the querying body for example
+    const DotBodyInterface* ignored_body_ptr = nullptr;
+    std::span<size_t> body_ids;
+    // Number of bodies overlapping, can be greater than body_ids.size(), only the first ones are written
+    size_t body_nbr = 0;
+};
+
+// Nearest bodies of a position sorted by surface distance, negative inside a body
+struct DotNearestQuery
+{
+    Float2d position;
+    float max_distance;
+    const DotBodyInterface* ignored_body_ptr = nullptr;
+    // The size of body_ids is the number of bodies searched, distances must have the same size
+    std::span<size_t> body_ids;
+    std::span<float> distances;
+    size_t body_nbr = 0;
+};
+
+// First body crossed by the segment start, end
+struct DotRaycastQuery
+{
+    Float2d start;
+    Float2d end;
+    const DotBodyInterface* ignored_body_ptr = nullptr;
+    bool has_hit = false;
+    size_t body_id = 0;
+    // Hit position is start + (end - start) * fraction, fraction is 0 when start is inside the body
+    float fraction = 0.0;
+    Float2d normal;
+};
@@ -0,0 +1,145 @@
+#include "./system_interface.hpp"
+#include "./physic_multithread_helper.hpp"
+#include <unordered_map>
+
+#pragma once
+
+// Levels with less systems than this are applied on the calling thread
+constexpr size_t SYSTEM_GRAPH_MULTITHREAD_MINIMUM_SYSTEM = 8;
+
+// Order systems in levels from their declared access, systems of a same level do not conflict and are applied concurrently
+class DotSystemGraph
+{
+    private:
+    struct BodyAccessLevel
+    {
+        // Minimum level of the next system writing / reading the body
+        size_t next_write_level;
+        size_t next_read_level;
+    };
+
+    std::vector<DotSystemInterface*> m_ordered_system_ptrs;
+    std::vector<size_t> m_level_offsets;
+
+    std::vector<size_t> m_system_levels;
+    std::unordered_map<const DotBodyInterface*, BodyAccessLevel> m_body_access_levels;
+    DotSystemAccess m_access_buffer;
+
+    std::function<void(const DotThreadTask&)> m_apply_multithread_function;
+    size_t m_apply_level_offset;
+
+    void apply_multithread_function(const DotThreadTask& task);
+
+    public:
+    DotSystemGraph():
+    m_level_offsets(1, 0),
+    m_apply_multithread_function(std::bind(&DotSystemGraph::apply_multithread_function, this, std::placeholders::_1)),
+    m_apply_level_offset(0)
+    {}
+
+    DotSystemGraph(const DotSystemGraph&) = delete;
+
+    // With is_reverse_order the systems are leveled from the last registered, as the low resolution loop always applied them
+    void build(const std::vector<std::shared_ptr<DotSystemInterface>>& system_ptrs, const bool is_reverse_order = false);
+    void apply(DotPhysicMultithreadHelper& multi_thread_helper, const float delta_t);
+
+    size_t get_level_nbr() const { return m_level_offsets.size() - 1; }
+};
+
+void DotSystemGraph::build(const std::vector<std::shared_ptr<DotSystemInterface>>& system_ptrs, const bool is_reverse_order)
+{
+    const size_t nbr_system = system_ptrs.size();
+    m_system_levels.resize(nbr_system);
+    m_body_access_levels.clear();
+
+    // Wavefront leveling in apply order, a system goes right after the last conflicting one
+    size_t nbr_level = 0;
+    size_t barrier_level = 0;
+    for(size_t i = 0; i < nbr_system; i++)
+    {
+        m_access_buffer.exclusive = false;
+        m_access_buffer.read_bodies.clear();
+        m_access_buffer.write_bodies.clear();
+        system_ptrs[is_reverse_order ? nbr_system - 1 - i : i]->declare_access(m_access_buffer);
+
+        size_t level = barrier_level;
+        if( m_access_buffer.exclusive )
+        {
+            level = nbr_level;
+            barrier_level = level + 1;
+        }
+        else
+        {
+            for(const DotBodyInterface* const body_ptr : m_access_buffer.write_bodies)
+            {
+                const BodyAccessLevel& access_level = m_body_access_levels[body_ptr];
+                level = std::max(level, std::max(access_level.next_write_level, access_level.next_read_level));
+            }
+            // Only the writers raise next_read_level, readers of a same body share a level
+            for(const DotBodyInterface* const body_ptr : m_access_buffer.read_bodies)
+            {
+                level = std::max(level, m_body_access_levels[body_ptr].next_read_level);
+            }
+
+            for(const DotBodyInterface* const body_ptr : m_access_buffer.write_bodies)
+            {
+                BodyAccessLevel& access_level = m_body_access_levels[body_ptr];
+                access_level.next_write_level = std::max(access_level.next_write_level, level + 1);
+                access_level.next_read_level = std::max(access_level.next_read_level, level + 1);
+            }
+            for(const DotBodyInterface* const body_ptr : m_access_buffer.read_bodies)
+            {
+                BodyAccessLevel& access_level = m_body_access_levels[body_ptr];
+                access_level.next_write_level = std::max(access_level.next_write_level, level + 1);
+            }
+        }
+
+        m_system_levels[i] = level;
+        nbr_level = std::max(nbr_level, level + 1);
+    }
+
+    // Counting sort of the systems by level, keeping apply order inside a level
+    m_level_offsets.assign(nbr_level + 1, 0);
+    for(size_t i = 0; i < nbr_system; i++) m_level_offsets[m_system_levels[i] + 1] += 1;
+    for(size_t level = 0; level < nbr_level; level++) m_level_offsets[level + 1] += m_level_offsets[level];
+
+    std::vector<size_t> insert_positions(m_level_offsets.begin(), m_level_offsets.end() - 1);
+    m_ordered_system_ptrs.resize(nbr_system);
+    for(size_t i = 0; i < nbr_system; i++)
+    {
+        const size_t level = m_system_levels[i];
+        m_ordered_system_ptrs[insert_positions[level]] = system_ptrs[is_reverse_order ? nbr_system - 1 - i : i].get();
+        insert_positions[level] += 1;
+    }
+}
+
+void DotSystemGraph::apply(DotPhysicMultithreadHelper& multi_thread_helper, const float delta_t)
+{
+    const size_t nbr_level = get_level_nbr();
+    for(size_t level = 0; level < nbr_level; level++)
+    {
+        const size_t level_start = m_level_offsets[level];
+        const size_t level_size = m_level_offsets[level + 1] - level_start;
+
+        // An exclusive system is alone in its level and may use the multithread helper itself, it runs on the calling thread
+        if( level_size < SYSTEM_GRAPH_MULTITHREAD_MINIMUM_SYSTEM )
+        {
+            for(size_t i = level_start; i < level_start + level_size; i++) m_ordered_system_ptrs[i]->apply(delta_t);
+        }
+        else
+        {
+            m_apply_level_offset = level_start;
+            multi_thread_helper.custom_function(delta_t, level_size, &m_apply_multithread_function);
+        }
+    }
+}
+
+void DotSystemGraph::apply_multithread_function(const DotThreadTask& task)
+{
+    const size_t start = m_apply_level_offset + task.id_start;
+    const size_t end_excluded = start + task.id_size;
+    for(size_t i = start; i < end_excluded; i++)
+    {
+        m_ordered_system_ptrs[i]->apply(task.dt);
+    }
+}
@@ -1,41 +1,151 @@
 #include "./body_interface.hpp"
 #include <memory>
 #include <vector>
+#include <cstdint>
+#include <limits>
 
 #pragma once
 
 struct DotCollisionInfo
 {
-    DotBodyInterface* const body_a;
-    DotBodyInterface* const body_b;
+    DotBodyInterface* body_a;
+    DotBodyInterface* body_b;
+    // Index of the bodies in the body list of the engine
+    size_t body_a_id;
+    size_t body_b_id;
+    // Distance between the surfaces at the start of the tick, negative when the bodies overlap
+    // Positive for pairs kept by the contact margin or by continuous collision
+    float distance;
+    // False for pairs only kept by the contact margin, continuous collision pairs count as touching
+    bool is_touching;
 
     DotCollisionInfo():
     body_a(nullptr),
-    body_b(nullptr)
+    body_b(nullptr),
+    body_a_id(0),
+    body_b_id(0),
+    distance(0.0),
+    is_touching(true)
     {}
 
     DotCollisionInfo(const std::shared_ptr<DotBodyInterface>& _body_a, const std::shared_ptr<DotBodyInterface>& _body_b):
     body_a(_body_a.get()), 
-    body_b(_body_b.get())
+    body_b(_body_b.get()),
+    body_a_id(0),
+    body_b_id(0),
+    distance(0.0),
+    is_touching(true)
     {}
 
     DotCollisionInfo(DotBodyInterface* const _body_a, DotBodyInterface* const _body_b):
     body_a(_body_a),
-    body_b(_body_b)
+    body_b(_body_b),
+    body_a_id(0),
+    body_b_id(0),
+    distance(0.0),
+    is_touching(true)
     {}
 
+    DotCollisionInfo(DotBodyInterface* const _body_a, DotBodyInterface* const _body_b, const size_t _body_a_id, const size_t _body_b_id, const float _distance, const bool _is_touching):
+    body_a(_body_a),
+    body_b(_body_b),
+    body_a_id(_body_a_id),
+    body_b_id(_body_b_id),
+    distance(_distance),
+    is_touching(_is_touching)
+    {}
+
+};
+
+// Collisions routed to a system, the default filter match every collision
+struct DotCollisionFilter
+{
+    // Both bodies must have all these DotBodyTypeFlag
+    uint32_t body_type_flags = 0;
+    // Both bodies must be in one of these layers
+    uint32_t layers = UINT32_MAX;
+    // When set, one of the bodies must be this body
+    const DotBodyInterface* body_ptr = nullptr;
+    // Skip the pairs only kept by the contact margin
+    bool touching_only = false;
+
+    bool match(const DotCollisionInfo& info) const {
+        if( touching_only && !info.is_touching ) return false;
+        if( body_ptr != nullptr && info.body_a != body_ptr && info.body_b != body_ptr ) return false;
+        return ((info.body_a->get_body_type_flags() & body_type_flags) == body_type_flags)
+            && ((info.body_b->get_body_type_flags() & body_type_flags) == body_type_flags)
+            && (info.body_a->get_collision_layers() & layers)
+            && (info.body_b->get_collision_layers() & layers);
+    }
+
+    bool operator==(const DotCollisionFilter& other) const {
+        return body_type_flags == other.body_type_flags
+            && layers == other.layers
+            && body_ptr == other.body_ptr
+            && touching_only == other.touching_only;
+    }
+};
+
+// Channel of the systems that receive the full collision list
+constexpr size_t COLLISION_CHANNEL_ALL = std::numeric_limits<size_t>::max();
+
+// Bodies a system read and write during apply, systems with no conflicting access can be applied concurrently
+struct DotSystemAccess
+{
+    // An exclusive system may touch any body or use the multithread helper, it is always applied alone
+    bool exclusive;
+    std::vector<const DotBodyInterface*> read_bodies;
+    std::vector<const DotBodyInterface*> write_bodies;
 };
 
 class DotPhysicMultithreadHelper;
+class DotContactAdjacency;
+struct DotContactEvents;
 class DotSystemInterface : public Destroyable
 {
     protected:
     DotPhysicMultithreadHelper* m_multi_thread_helper_ptr;
+    // Contacts of each body, rebuilt by the engine before the systems are applied
+    const DotContactAdjacency* m_contact_adjacency_ptr;
+    // Set by the engine, systems with the same filter share a channel
+    size_t m_collision_channel_id;
 
     public:
+    DotSystemInterface():m_multi_thread_helper_ptr(nullptr), m_contact_adjacency_ptr(nullptr), m_collision_channel_id(COLLISION_CHANNEL_ALL){}
     void set_multi_thread_helper_ptr(DotPhysicMultithreadHelper*const multi_thread_helper_ptr){m_multi_thread_helper_ptr = multi_thread_helper_ptr;}
+    void set_contact_adjacency_ptr(const DotContactAdjacency*const contact_adjacency_ptr){m_contact_adjacency_ptr = contact_adjacency_ptr;}
     virtual ~DotSystemInterface(){}
     virtual void apply( [[maybe_unused]] const float delta_t) = 0;
     virtual void on_body_list_update([[maybe_unused]] const std::vector<std::shared_ptr<DotBodyInterface>>& body_ptrs){};
+    // Only the collisions matching the collision filter of the system, in the order of the full list
     virtual void on_collision_list_update([[maybe_unused]] const std::vector<DotCollisionInfo>& collision_infos){};
+    // Return false to receive the full collision list, the filter is read again when the engine invalidate the channels
+    virtual bool get_collision_filter([[maybe_unused]] DotCollisionFilter& filter) const { return false; }
+    size_t get_collision_channel_id() const { return m_collision_channel_id; }
+    void set_collision_channel_id(const size_t collision_channel_id){m_collision_channel_id = collision_channel_id;}
+    // Pairs with a sensor body, called after on_collision_list_update, sensor pairs are never in the collision list
+    virtual void on_sensor_list_update([[maybe_unused]] const std::vector<DotCollisionInfo>& sensor_infos){};
+    // Called after on_collision_list_update when the engine track the contact events, collision ids index collision_infos
+    virtual void on_contact_events([[maybe_unused]] const DotContactEvents& contact_events, [[maybe_unused]] const std::vector<DotCollisionInfo>& collision_infos){};
+    // Called when the engine remove the destroyed system, to undo what the system left on the bodies
+    virtual void on_unregister(){};
+
+    // A body pass system only touch one body at a time, the engine call apply_on_body inside its per body passes instead of apply
+    virtual bool is_body_pass_system() const { return false; }
+    // body_id is the index of the body in the last list given to on_body_list_update
+    virtual void apply_on_body([[maybe_unused]] const size_t body_id, [[maybe_unused]] const float delta_t){};
+    // Called alone before each body pass that use apply_on_body, may use the multithread helper
+    virtual void prepare_body_pass([[maybe_unused]] const float delta_t){};
+
+    // Fill the bodies touched by apply, a system that does not override it is exclusive
+    virtual void declare_access(DotSystemAccess& access) const { access.exclusive = true; }
+
+    // Add the bodies moved by the system during the high resolution loop, return false when they are unknown
+    virtual bool declare_high_resolution_bodies(DotSystemAccess& access) const {
+        declare_access(access);
+        return !access.exclusive;
+    }
+
+    // Highest stiffness / mass ratio applied by the system, used by the adaptive high resolution
+    virtual float get_max_stiffness_to_mass_ratio() const { return 0.0; }
 };
@@ -0,0 +1,191 @@
+#include "./float2d.hpp"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#pragma once
+
+// Maximum number of sources in a leaf
+constexpr size_t BARNES_HUT_TREE_LEAF_SIZE = 4;
+// Sources still together at this depth stay in one leaf, it bound the traversal stack
+constexpr size_t BARNES_HUT_TREE_MAX_DEPTH = 24;
+// Source id given for a group of sources
+constexpr size_t BARNES_HUT_TREE_GROUP = std::numeric_limits<size_t>::max();
+
+// Quadtree of point masses, a group of far sources is seen as one mass at its center of mass
+// A group is used when its size / distance is under the opening angle
+class DotBarnesHutTree
+{
+    private:
+    struct Node
+    {
+        Float2d center_of_mass;
+        float mass;
+        Float2d center;
+        float half_size;
+        // Index of the first of the 4 children, 0 for a leaf
+        uint32_t first_child;
+        uint32_t source_start;
+        uint32_t source_count;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Float2d> m_positions;
+    std::vector<float> m_masses;
+    // Source ids sorted so every node own a contiguous range
+    std::vector<size_t> m_source_ids;
+
+    void build_node(const uint32_t node_id, const size_t depth);
+
+    public:
+    DotBarnesHutTree(){}
+
+    // Remove every source, call before adding the sources of a new build
+    void clear() {
+        m_positions.clear();
+        m_masses.clear();
+    }
+
+    // Source id is the order of addition
+    void add_source(const Float2d& position, const float mass) {
+        m_positions.push_back(position);
+        m_masses.push_back(mass);
+    }
+
+    size_t get_source_nbr() const { return m_positions.size(); }
+    size_t get_node_nbr() const { return m_nodes.size(); }
+
+    // Build the tree over the added sources
+    void build();
+
+    // Call function(position, mass, source_id) for every source or group that act on position
+    // Groups have the source id BARNES_HUT_TREE_GROUP, a source is never given inside a group that contain the position
+    template<typename Function>
+    void for_each_source(const Float2d& position, const float opening_angle, Function&& function) const;
+};
+
+void DotBarnesHutTree::build()
+{
+    m_nodes.clear();
+    const size_t nbr_source = m_positions.size();
+    m_source_ids.resize(nbr_source);
+    for( size_t i = 0; i < nbr_source; i++ ) m_source_ids[i] = i;
+    if( nbr_source == 0 ) return;
+
+    // Square root node around every source
+    Float2d min_position = m_positions[0];
+    Float2d max_position = m_positions[0];
+    for( const Float2d& position : m_positions )
+    {
+        min_position = Float2d(std::min(min_position.x(), position.x()), std::min(min_position.y(), position.y()));
+        max_position = Float2d(std::max(max_position.x(), position.x()), std::max(max_position.y(), position.y()));
+    }
+
+    Node root;
+    root.center = (min_position + max_position) / 2;
+    root.half_size = std::max(max_position.x() - min_position.x(), max_position.y() - min_position.y()) / 2;
+    root.first_child = 0;
+    root.source_start = 0;
+    root.source_count = uint32_t(nbr_source);
+    m_nodes.push_back(root);
+    build_node(0, 0);
+}
+
+void DotBarnesHutTree::build_node(const uint32_t node_id, const size_t depth)
+{
+    const size_t source_start = m_nodes[node_id].source_start;
+    const size_t source_count = m_nodes[node_id].source_count;
+    const std::vector<size_t>::iterator begin = m_source_ids.begin() + source_start;
+    const std::vector<size_t>::iterator end = begin + source_count;
+
+    if( source_count > BARNES_HUT_TREE_LEAF_SIZE && depth < BARNES_HUT_TREE_MAX_DEPTH )
+    {
+        // Split in 4 quadrants, children order is (-x,-y) (+x,-y) (-x,+y) (+x,+y)
+        const Float2d center = m_nodes[node_id].center;
+        const float child_half_size = m_nodes[node_id].half_size / 2;
+        const std::vector<size_t>::iterator split_y = std::partition(begin, end, [this, &center](const size_t id){ return m_positions[id].y() < center.y(); });
+        const std::vector<size_t>::iterator split_x_low = std::partition(begin, split_y, [this, &center](const size_t id){ return m_positions[id].x() < center.x(); });
+        const std::vector<size_t>::iterator split_x_high = std::partition(split_y, end, [this, &center](const size_t id){ return m_positions[id].x() < center.x(); });
+        const std::vector<size_t>::iterator bounds[5] = {begin, split_x_low, split_y, split_x_high, end};
+
+        const uint32_t first_child = uint32_t(m_nodes.size());
+        m_nodes[node_id].first_child = first_child;
+        for( uint8_t k = 0; k < 4; k++ )
+        {
+            Node child;
+            child.center = center + Float2d((k & 1) ? child_half_size : -child_half_size, (k & 2) ? child_half_size : -child_half_size);
+            child.half_size = child_half_size;
+            child.first_child = 0;
+            child.source_start = uint32_t(bounds[k] - m_source_ids.begin());
+            child.source_count = uint32_t(bounds[k+1] - bounds[k]);
+            m_nodes.push_back(child);
+        }
+
+        float mass = 0.0;
+        Float2d weighted_position_sum;
+        for( uint8_t k = 0; k < 4; k++ )
+        {
+            build_node(first_child + k, depth + 1);
+            const Node& child = m_nodes[first_child + k];
+            mass += child.mass;
+            weighted_position_sum += child.center_of_mass * child.mass;
+        }
+        m_nodes[node_id].mass = mass;
+        m_nodes[node_id].center_of_mass = mass > 0.0 ? weighted_position_sum / mass : center;
+        return;
+    }
+
+    float mass = 0.0;
+    Float2d weighted_position_sum;
+    for( std::vector<size_t>::iterator it = begin; it != end; it++ )
+    {
+        mass += m_masses[*it];
+        weighted_position_sum += m_positions[*it] * m_masses[*it];
+    }
+    m_nodes[node_id].mass = mass;
+    m_nodes[node_id].center_of_mass = mass > 0.0 ? weighted_position_sum / mass : m_nodes[node_id].center;
+}
+
+template<typename Function>
+void DotBarnesHutTree::for_each_source(const Float2d& position, const float opening_angle, Function&& function) const
+{
+    if( m_nodes.empty() ) return;
+
+    const float opening_angle_2 = opening_angle * opening_angle;
+    uint32_t stack[(3 * BARNES_HUT_TREE_MAX_DEPTH) + 1];
+    size_t stack_size = 1;
+    stack[0] = 0;
+
+    while( stack_size > 0 )
+    {
+        stack_size -= 1;
+        const Node& node = m_nodes[stack[stack_size]];
+        if( node.mass <= 0.0 ) continue;
+
+        if( node.first_child == 0 )
+        {
+            const size_t source_end = node.source_start + node.source_count;
+            for( size_t i = node.source_start; i < source_end; i++ )
+            {
+                const size_t source_id = m_source_ids[i];
+                function(m_positions[source_id], m_masses[source_id], source_id);
+            }
+            continue;
+        }
+
+        // A node far enough is used as a group, the size of a node is its side
+        const float size = 2 * node.half_size;
+        const float distance_2 = (node.center_of_mass - position).norm2();
+        const bool is_inside = std::abs(position.x() - node.center.x()) <= node.half_size && std::abs(position.y() - node.center.y()) <= node.half_size;
+        if( !is_inside && size * size < opening_angle_2 * distance_2 )
+        {
+            function(node.center_of_mass, node.mass, BARNES_HUT_TREE_GROUP);
+            continue;
+        }
+
+        for( uint32_t k = 0; k < 4; k++ ) stack[stack_size + k] = node.first_child + k;
+        stack_size += 4;
+    }
+}
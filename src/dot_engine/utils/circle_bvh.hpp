@@ -0,0 +1,348 @@
+#include "./float2d.hpp"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#pragma once
+
+// Maximum number of circles in a leaf
+constexpr size_t CIRCLE_BVH_LEAF_SIZE = 4;
+// Median splits keep the depth under 32 for any uint32_t circle number, the traversal stack hold one node per level
+constexpr size_t CIRCLE_BVH_STACK_SIZE = 64;
+
+// Binary bounding volume hierarchy of circles, nodes bound the axis aligned bounds of their circles
+// Other shapes are added by their bounds only, the queries test them with the function they are given
+// Every query is const and can run on several threads at once
+class DotCircleBvh
+{
+    private:
+    struct Node
+    {
+        Float2d min;
+        Float2d max;
+        // Index of the first of the 2 children for a node, of the first circle for a leaf
+        uint32_t first;
+        // Number of circles of a leaf, 0 for a node
+        uint32_t count;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Float2d> m_centers;
+    std::vector<float> m_radii;
+    // Half extents of the bounds along each axis, the radius for a circle
+    std::vector<Float2d> m_half_extents;
+    // Shapes added by their bounds, they have no radius
+    std::vector<uint8_t> m_bounds_only;
+    // Circle ids sorted so every node own a contiguous range
+    std::vector<uint32_t> m_circle_ids;
+
+    void build_node(const uint32_t node_id, const uint32_t start, const uint32_t count);
+
+    // Distance from position to the bounds of a node, 0 inside
+    static float get_box_distance(const Node& node, const Float2d& position) {
+        const float dx = std::max(std::max(node.min.x() - position.x(), position.x() - node.max.x()), 0.0f);
+        const float dy = std::max(std::max(node.min.y() - position.y(), position.y() - node.max.y()), 0.0f);
+        return std::sqrt((dx * dx) + (dy * dy));
+    }
+
+    // Clip the fraction range of a segment to a slab of one axis, false when the range become empty
+    static bool clip_axis(const float start, const float direction, const float inverse_direction, const float min, const float max, float& t_min, float& t_max);
+    // True when the segment, up to max_fraction, cross the node bounds
+    static bool get_box_entry(const Node& node, const Float2d& start, const Float2d& direction, const Float2d& inverse_direction, const float max_fraction);
+
+    public:
+    DotCircleBvh(){}
+
+    // Remove every circle, call before adding the circles of a new build
+    void clear() {
+        m_centers.clear();
+        m_radii.clear();
+        m_half_extents.clear();
+        m_bounds_only.clear();
+    }
+
+    // Circle id is the order of addition, shapes added by their bounds share the ids
+    void add_circle(const Float2d& center, const float radius) {
+        m_centers.push_back(center);
+        m_radii.push_back(radius);
+        m_half_extents.push_back(Float2d(radius, radius));
+        m_bounds_only.push_back(0);
+    }
+
+    // Shape in the axis aligned bounds center, half_extent, the queries test it with their shape function
+    void add_bounds(const Float2d& center, const Float2d& half_extent) {
+        m_centers.push_back(center);
+        m_radii.push_back(0.0);
+        m_half_extents.push_back(half_extent);
+        m_bounds_only.push_back(1);
+    }
+
+    size_t get_circle_nbr() const { return m_centers.size(); }
+    size_t get_node_nbr() const { return m_nodes.size(); }
+
+    // Build the tree over the added circles
+    void build();
+
+    // Call function(circle_id) for every circle accepted by filter(circle_id) that overlap the circle center, radius
+    // shape_distance(circle_id, point) give the surface distance of the shapes added by their bounds
+    template<typename Filter, typename ShapeDistance, typename Function>
+    void for_each_overlap(const Float2d& center, const float radius, Filter&& filter, ShapeDistance&& shape_distance, Function&& function) const;
+
+    // Write the ids and the surface distances of the nearest circles accepted by filter, sorted by distance
+    // Distances are negative inside a circle, circles farther than max_distance are ignored, return the number found
+    // shape_distance(circle_id, point) give the surface distance of the shapes added by their bounds
+    template<typename Filter, typename ShapeDistance>
+    size_t find_nearest(const Float2d& position, const float max_distance, const size_t max_nbr, Filter&& filter, ShapeDistance&& shape_distance, size_t* const circle_ids, float* const distances) const;
+
+    // First circle accepted by filter on the segment start, end, fraction is 0 when start is inside the circle
+    // shape_raycast(circle_id, start, direction, fraction, normal) give the first hit of the shapes added by their bounds
+    template<typename Filter, typename ShapeRaycast>
+    bool raycast(const Float2d& start, const Float2d& end, Filter&& filter, ShapeRaycast&& shape_raycast, size_t& circle_id, float& fraction, Float2d& normal) const;
+};
+
+void DotCircleBvh::build()
+{
+    m_nodes.clear();
+    const uint32_t nbr_circle = uint32_t(m_centers.size());
+    m_circle_ids.resize(nbr_circle);
+    for( uint32_t i = 0; i < nbr_circle; i++ ) m_circle_ids[i] = i;
+    if( nbr_circle == 0 ) return;
+
+    // Leaves hold at least 2 circles, so there is less nodes than circles
+    m_nodes.reserve(nbr_circle);
+    m_nodes.emplace_back();
+    build_node(0, 0, nbr_circle);
+}
+
+void DotCircleBvh::build_node(const uint32_t node_id, const uint32_t start, const uint32_t count)
+{
+    const std::vector<uint32_t>::iterator begin = m_circle_ids.begin() + start;
+    const std::vector<uint32_t>::iterator end = begin + count;
+
+    // Bounds of the circles for the queries, bounds of the centers for the split
+    Float2d min = m_centers[*begin] - m_half_extents[*begin];
+    Float2d max = m_centers[*begin] + m_half_extents[*begin];
+    Float2d center_min = m_centers[*begin];
+    Float2d center_max = m_centers[*begin];
+    for( std::vector<uint32_t>::iterator it = begin; it != end; it++ )
+    {
+        const Float2d& center = m_centers[*it];
+        const Float2d& half_extent = m_half_extents[*it];
+        min = Float2d(std::min(min.x(), center.x() - half_extent.x()), std::min(min.y(), center.y() - half_extent.y()));
+        max = Float2d(std::max(max.x(), center.x() + half_extent.x()), std::max(max.y(), center.y() + half_extent.y()));
+        center_min = Float2d(std::min(center_min.x(), center.x()), std::min(center_min.y(), center.y()));
+        center_max = Float2d(std::max(center_max.x(), center.x()), std::max(center_max.y(), center.y()));
+    }
+    m_nodes[node_id].min = min;
+    m_nodes[node_id].max = max;
+
+    if( count <= CIRCLE_BVH_LEAF_SIZE )
+    {
+        m_nodes[node_id].first = start;
+        m_nodes[node_id].count = count;
+        return;
+    }
+
+    // Median split along the longest side of the center bounds
+    const bool split_x = (center_max.x() - center_min.x()) >= (center_max.y() - center_min.y());
+    const uint32_t half_count = count / 2;
+    std::nth_element(begin, begin + half_count, end, [this, split_x](const uint32_t a, const uint32_t b){
+        return split_x ? m_centers[a].x() < m_centers[b].x() : m_centers[a].y() < m_centers[b].y();
+    });
+
+    const uint32_t first_child = uint32_t(m_nodes.size());
+    m_nodes[node_id].first = first_child;
+    m_nodes[node_id].count = 0;
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    build_node(first_child, start, half_count);
+    build_node(first_child + 1, start + half_count, count - half_count);
+}
+
+bool DotCircleBvh::clip_axis(const float start, const float direction, const float inverse_direction, const float min, const float max, float& t_min, float& t_max)
+{
+    // Parallel to the slab, no infinity so it hold with fast math
+    if( direction == 0.0 ) return start >= min && start <= max;
+    const float t_0 = (min - start) * inverse_direction;
+    const float t_1 = (max - start) * inverse_direction;
+    t_min = std::max(t_min, std::min(t_0, t_1));
+    t_max = std::min(t_max, std::max(t_0, t_1));
+    return t_min <= t_max;
+}
+
+bool DotCircleBvh::get_box_entry(const Node& node, const Float2d& start, const Float2d& direction, const Float2d& inverse_direction, const float max_fraction)
+{
+    float t_min = 0.0;
+    float t_max = max_fraction;
+    return clip_axis(start.x(), direction.x(), inverse_direction.x(), node.min.x(), node.max.x(), t_min, t_max)
+        && clip_axis(start.y(), direction.y(), inverse_direction.y(), node.min.y(), node.max.y(), t_min, t_max);
+}
+
+template<typename Filter, typename ShapeDistance, typename Function>
+void DotCircleBvh::for_each_overlap(const Float2d& center, const float radius, Filter&& filter, ShapeDistance&& shape_distance, Function&& function) const
+{
+    if( m_nodes.empty() ) return;
+
+    uint32_t stack[CIRCLE_BVH_STACK_SIZE];
+    size_t stack_size = 1;
+    stack[0] = 0;
+
+    while( stack_size > 0 )
+    {
+        stack_size -= 1;
+        const Node& node = m_nodes[stack[stack_size]];
+        if( get_box_distance(node, center) >= radius ) continue;
+
+        if( node.count == 0 )
+        {
+            stack[stack_size] = node.first;
+            stack[stack_size + 1] = node.first + 1;
+            stack_size += 2;
+            continue;
+        }
+
+        const uint32_t circle_end = node.first + node.count;
+        for( uint32_t i = node.first; i < circle_end; i++ )
+        {
+            const uint32_t circle_id = m_circle_ids[i];
+            if( m_bounds_only[circle_id] )
+            {
+                if( shape_distance(size_t(circle_id), center) < radius && filter(size_t(circle_id)) ) function(size_t(circle_id));
+                continue;
+            }
+            const float critical_dist = radius + m_radii[circle_id];
+            if( (m_centers[circle_id] - center).norm2() < critical_dist * critical_dist && filter(size_t(circle_id)) ) function(size_t(circle_id));
+        }
+    }
+}
+
+template<typename Filter, typename ShapeDistance>
+size_t DotCircleBvh::find_nearest(const Float2d& position, const float max_distance, const size_t max_nbr, Filter&& filter, ShapeDistance&& shape_distance, size_t* const circle_ids, float* const distances) const
+{
+    if( m_nodes.empty() || max_nbr == 0 ) return 0;
+
+    size_t nbr_found = 0;
+    uint32_t stack[CIRCLE_BVH_STACK_SIZE];
+    size_t stack_size = 1;
+    stack[0] = 0;
+
+    while( stack_size > 0 )
+    {
+        // Circles farther than the worst kept one cannot enter the result
+        const float worst_distance = nbr_found == max_nbr ? distances[max_nbr - 1] : max_distance;
+
+        stack_size -= 1;
+        const Node& node = m_nodes[stack[stack_size]];
+        if( get_box_distance(node, position) > worst_distance ) continue;
+
+        if( node.count == 0 )
+        {
+            // The nearest child is pushed last so it is visited first
+            const bool first_is_nearest = get_box_distance(m_nodes[node.first], position) <= get_box_distance(m_nodes[node.first + 1], position);
+            stack[stack_size] = first_is_nearest ? node.first + 1 : node.first;
+            stack[stack_size + 1] = first_is_nearest ? node.first : node.first + 1;
+            stack_size += 2;
+            continue;
+        }
+
+        const uint32_t circle_end = node.first + node.count;
+        for( uint32_t i = node.first; i < circle_end; i++ )
+        {
+            const uint32_t circle_id = m_circle_ids[i];
+            const float distance = m_bounds_only[circle_id] ? shape_distance(size_t(circle_id), position) : (m_centers[circle_id] - position).norm() - m_radii[circle_id];
+            const float current_worst_distance = nbr_found == max_nbr ? distances[max_nbr - 1] : max_distance;
+            if( distance > current_worst_distance || !filter(size_t(circle_id)) ) continue;
+
+            // Insertion in the sorted result, the worst is dropped when full
+            size_t insert_id = nbr_found < max_nbr ? nbr_found : max_nbr - 1;
+            while( insert_id > 0 && distances[insert_id - 1] > distance )
+            {
+                distances[insert_id] = distances[insert_id - 1];
+                circle_ids[insert_id] = circle_ids[insert_id - 1];
+                insert_id -= 1;
+            }
+            distances[insert_id] = distance;
+            circle_ids[insert_id] = circle_id;
+            if( nbr_found < max_nbr ) nbr_found += 1;
+        }
+    }
+    return nbr_found;
+}
+
+template<typename Filter, typename ShapeRaycast>
+bool DotCircleBvh::raycast(const Float2d& start, const Float2d& end, Filter&& filter, ShapeRaycast&& shape_raycast, size_t& circle_id, float& fraction, Float2d& normal) const
+{
+    if( m_nodes.empty() ) return false;
+
+    const Float2d direction = end - start;
+    const float direction_norm2 = direction.norm2();
+    const Float2d inverse_direction(direction.x() != 0.0 ? 1.0f / direction.x() : 0.0f, direction.y() != 0.0 ? 1.0f / direction.y() : 0.0f);
+
+    bool has_hit = false;
+    float best_fraction = 1.0;
+    uint32_t stack[CIRCLE_BVH_STACK_SIZE];
+    size_t stack_size = 1;
+    stack[0] = 0;
+
+    while( stack_size > 0 )
+    {
+        stack_size -= 1;
+        const Node& node = m_nodes[stack[stack_size]];
+        if( !get_box_entry(node, start, direction, inverse_direction, best_fraction) ) continue;
+
+        if( node.count == 0 )
+        {
+            stack[stack_size] = node.first;
+            stack[stack_size + 1] = node.first + 1;
+            stack_size += 2;
+            continue;
+        }
+
+        const uint32_t circle_end = node.first + node.count;
+        for( uint32_t i = node.first; i < circle_end; i++ )
+        {
+            const uint32_t id = m_circle_ids[i];
+            if( m_bounds_only[id] )
+            {
+                float shape_fraction;
+                Float2d shape_normal;
+                if( !shape_raycast(size_t(id), start, direction, shape_fraction, shape_normal) || shape_fraction > best_fraction || !filter(size_t(id)) ) continue;
+                has_hit = true;
+                best_fraction = shape_fraction;
+                circle_id = id;
+                normal = shape_normal;
+                continue;
+            }
+
+            const Float2d center_to_start = start - m_centers[id];
+            const float radius_2 = m_radii[id] * m_radii[id];
+            const float c = center_to_start.norm2() - radius_2;
+
+            // Smallest root of |center_to_start + t * direction|^2 = radius^2
+            float t;
+            if( c < 0.0 ) t = 0.0;
+            else
+            {
+                if( direction_norm2 <= 0.0 ) continue;
+                const float b = Float2d::dot_product(center_to_start, direction);
+                const float discriminant = (b * b) - (direction_norm2 * c);
+                if( b >= 0.0 || discriminant < 0.0 ) continue;
+                t = (-b - std::sqrt(discriminant)) / direction_norm2;
+            }
+            if( t > best_fraction || !filter(size_t(id)) ) continue;
+
+            has_hit = true;
+            best_fraction = t;
+            circle_id = id;
+            const Float2d center_to_hit = center_to_start + (direction * t);
+            const float center_to_hit_norm = center_to_hit.norm();
+            if( center_to_hit_norm > 0.0 ) normal = center_to_hit / center_to_hit_norm;
+            else normal = direction_norm2 > 0.0 ? -direction / std::sqrt(direction_norm2) : Float2d();
+        }
+    }
+
+    fraction = best_fraction;
+    return has_hit;
+}
@@ -0,0 +1,69 @@
+#include <atomic>
+#include <utility>
+
+#pragma once
+
+// Multi producer / single consumer queue, push never block and the consumer take all the pending commands at once
+template<typename T>
+class DotCommandQueue
+{
+    private:
+    struct Node
+    {
+        T value;
+        Node* next;
+    };
+
+    // Last pushed command, the list is in reverse push order
+    std::atomic<Node*> m_head;
+
+    public:
+    DotCommandQueue():m_head(nullptr){}
+    DotCommandQueue(const DotCommandQueue&) = delete;
+
+    ~DotCommandQueue()
+    {
+        Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+        while( node )
+        {
+            Node* const next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // Thread safe
+    void push(T value)
+    {
+        Node* const node = new Node{std::move(value), m_head.load(std::memory_order_relaxed)};
+        while( !m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed) );
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_relaxed) == nullptr; }
+
+    // Consumer only, call function on every pending command in push order
+    template<typename Function>
+    void drain(Function&& function)
+    {
+        Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+        if( !node ) return;
+
+        // Reverse the list to execute in push order
+        Node* ordered_node = nullptr;
+        while( node )
+        {
+            Node* const next = node->next;
+            node->next = ordered_node;
+            ordered_node = node;
+            node = next;
+        }
+
+        while( ordered_node )
+        {
+            Node* const next = ordered_node->next;
+            function(ordered_node->value);
+            delete ordered_node;
+            ordered_node = next;
+        }
+    }
+};
@@ -0,0 +1,133 @@
+#include "./float2d.hpp"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+#pragma once
+
+// Nested square grids of vectors around a center, each level cover twice the extent of the previous one
+// A position is sampled on the finest level that contain it with a bilinear interpolation
+class DotFieldGrid
+{
+    private:
+    Float2d m_center;
+    float m_half_extent;
+    size_t m_resolution;
+    size_t m_level_nbr;
+
+    // Node values by level, then by row
+    std::vector<Float2d> m_values;
+    // Cells where the interpolation is not valid, by level, then by row
+    std::vector<uint8_t> m_invalid_cells;
+
+    size_t get_level(const Float2d& position) const;
+    float get_spacing(const size_t level) const { return (2 * m_half_extent * float(size_t(1) << level)) / float(m_resolution - 1); }
+    Float2d get_origin(const size_t level) const {
+        const float half_extent = m_half_extent * float(size_t(1) << level);
+        return m_center - Float2d(half_extent, half_extent);
+    }
+
+    public:
+    DotFieldGrid():
+    m_half_extent(0.0),
+    m_resolution(0),
+    m_level_nbr(0)
+    {}
+
+    // Level 0 cover center +- half_extent with resolution x resolution nodes, the values are left null
+    void reset(const Float2d& center, const float half_extent, const size_t resolution, const size_t level_nbr);
+
+    size_t get_node_nbr() const { return m_values.size(); }
+    size_t get_level_nbr() const { return m_level_nbr; }
+
+    // Position of a node, node_id index every level
+    Float2d get_node_position(const size_t node_id) const;
+    void set_node_value(const size_t node_id, const Float2d& value) { m_values[node_id] = value; }
+
+    // Cells of every level around position become invalid, for points where the field is singular
+    void invalidate_around(const Float2d& position);
+
+    // Return false when the position is outside the grids or in an invalid cell
+    bool sample(const Float2d& position, Float2d& value) const;
+};
+
+void DotFieldGrid::reset(const Float2d& center, const float half_extent, const size_t resolution, const size_t level_nbr)
+{
+    m_center = center;
+    m_half_extent = half_extent;
+    m_resolution = std::max<size_t>(resolution, 2);
+    m_level_nbr = level_nbr;
+    m_values.assign(m_level_nbr * m_resolution * m_resolution, Float2d());
+    m_invalid_cells.assign(m_level_nbr * (m_resolution - 1) * (m_resolution - 1), 0);
+}
+
+Float2d DotFieldGrid::get_node_position(const size_t node_id) const
+{
+    const size_t nbr_node_per_level = m_resolution * m_resolution;
+    const size_t level = node_id / nbr_node_per_level;
+    const size_t level_node_id = node_id % nbr_node_per_level;
+    const float spacing = get_spacing(level);
+    return get_origin(level) + Float2d(float(level_node_id % m_resolution) * spacing, float(level_node_id / m_resolution) * spacing);
+}
+
+size_t DotFieldGrid::get_level(const Float2d& position) const
+{
+    // Finest level whose extent contain the position, m_level_nbr when outside
+    const Float2d diff = position - m_center;
+    const float distance = std::max(std::abs(diff.x()), std::abs(diff.y()));
+    size_t level = 0;
+    float half_extent = m_half_extent;
+    while( level < m_level_nbr && distance >= half_extent )
+    {
+        level += 1;
+        half_extent *= 2;
+    }
+    return level;
+}
+
+void DotFieldGrid::invalidate_around(const Float2d& position)
+{
+    // Cells within 2 cells of the position, the interpolation error grow fast close to a singular point
+    const size_t nbr_cell = m_resolution - 1;
+    for( size_t level = 0; level < m_level_nbr; level++ )
+    {
+        const Float2d local = (position - get_origin(level)) / get_spacing(level);
+        const long cell_x = long(std::floor(local.x()));
+        const long cell_y = long(std::floor(local.y()));
+        for( long y = cell_y - 2; y <= cell_y + 2; y++ )
+        {
+            if( y < 0 || y >= long(nbr_cell) ) continue;
+            for( long x = cell_x - 2; x <= cell_x + 2; x++ )
+            {
+                if( x < 0 || x >= long(nbr_cell) ) continue;
+                m_invalid_cells[(level * nbr_cell * nbr_cell) + (size_t(y) * nbr_cell) + size_t(x)] = 1;
+            }
+        }
+    }
+}
+
+bool DotFieldGrid::sample(const Float2d& position, Float2d& value) const
+{
+    const size_t level = get_level(position);
+    if( level >= m_level_nbr ) return false;
+
+    const size_t nbr_cell = m_resolution - 1;
+    const Float2d local = (position - get_origin(level)) / get_spacing(level);
+    const size_t cell_x = std::min(size_t(std::max(local.x(), 0.0f)), nbr_cell - 1);
+    const size_t cell_y = std::min(size_t(std::max(local.y(), 0.0f)), nbr_cell - 1);
+    if( m_invalid_cells[(level * nbr_cell * nbr_cell) + (cell_y * nbr_cell) + cell_x] ) return false;
+
+    const float t_x = std::clamp(local.x() - float(cell_x), 0.0f, 1.0f);
+    const float t_y = std::clamp(local.y() - float(cell_y), 0.0f, 1.0f);
+    const size_t node_id = (level * m_resolution * m_resolution) + (cell_y * m_resolution) + cell_x;
+    const Float2d& value_00 = m_values[node_id];
+    const Float2d& value_10 = m_values[node_id + 1];
+    const Float2d& value_01 = m_values[node_id + m_resolution];
+    const Float2d& value_11 = m_values[node_id + m_resolution + 1];
+
+    const Float2d value_0 = value_00 + ((value_10 - value_00) * t_x);
+    const Float2d value_1 = value_01 + ((value_11 - value_01) * t_x);
+    value = value_0 + ((value_1 - value_0) * t_y);
+    return true;
+}
@@ -0,0 +1,210 @@
+#include "./float2d.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#pragma once
+
+// Core of a body shape, a rectangle of center, unit axis and half extents
+// A point has null extents and a segment a null half width, the shape of a body is its core grown by its size
+struct DotShapeCore
+{
+    Float2d center;
+    Float2d axis;
+    // Half extents along the axis and along its perpendicular
+    float half_length;
+    float half_width;
+
+    DotShapeCore():
+    center(Float2d(0,0)),
+    axis(Float2d(1,0)),
+    half_length(0.0),
+    half_width(0.0)
+    {}
+
+    DotShapeCore(const Float2d& _center, const Float2d& _axis, const float _half_length, const float _half_width):
+    center(_center),
+    axis(_axis),
+    half_length(_half_length),
+    half_width(_half_width)
+    {}
+
+    // Segment from center - half_segment to center + half_segment
+    static DotShapeCore segment(const Float2d& center, const Float2d& half_segment) {
+        const float half_length = half_segment.norm();
+        return DotShapeCore(center, half_length > 0.0 ? half_segment / half_length : Float2d(1,0), half_length, 0.0);
+    }
+
+    Float2d get_perpendicular() const { return axis.perpendicular_counterclock(); }
+
+    // Corners, repeated for a point or a segment
+    Float2d get_vertex(const size_t vertex_id) const {
+        const float length = (vertex_id & 1) ? half_length : -half_length;
+        const float width = (vertex_id & 2) ? half_width : -half_width;
+        return center + (axis * length) + (get_perpendicular() * width);
+    }
+
+    // Signed distance from the core to point, negative inside, normal point from the core to point
+    float get_point_distance(const Float2d& point, Float2d& normal) const;
+
+    // Signed distance between 2 cores, negative when they overlap, normal point from a to b
+    static float get_distance(const DotShapeCore& core_a, const DotShapeCore& core_b, Float2d& normal_a2b);
+
+    // First hit of the segment start, start + direction on the core grown by radius
+    // fraction is 0 when start is inside, return false without hit
+    bool raycast(const Float2d& start, const Float2d& direction, const float radius, float& fraction, Float2d& normal) const;
+};
+
+float DotShapeCore::get_point_distance(const Float2d& point, Float2d& normal) const
+{
+    const Float2d perpendicular = get_perpendicular();
+    const Float2d diff = point - center;
+    const float local_x = Float2d::dot_product(diff, axis);
+    const float local_y = Float2d::dot_product(diff, perpendicular);
+    const Float2d axis_out = local_x < 0.0 ? -axis : axis;
+    const Float2d perpendicular_out = local_y < 0.0 ? -perpendicular : perpendicular;
+    const float outside_x = std::abs(local_x) - half_length;
+    const float outside_y = std::abs(local_y) - half_width;
+
+    if( outside_x > 0.0 || outside_y > 0.0 )
+    {
+        const float excess_x = std::max(outside_x, 0.0f);
+        const float excess_y = std::max(outside_y, 0.0f);
+        const float distance = std::sqrt((excess_x * excess_x) + (excess_y * excess_y));
+        normal = ((axis_out * excess_x) + (perpendicular_out * excess_y)) / distance;
+        return distance;
+    }
+
+    // Inside, the nearest side give the way out
+    if( outside_x > outside_y )
+    {
+        normal = axis_out;
+        return outside_x;
+    }
+    normal = perpendicular_out;
+    return outside_y;
+}
+
+float DotShapeCore::get_distance(const DotShapeCore& core_a, const DotShapeCore& core_b, Float2d& normal_a2b)
+{
+    // Separating axis test on the sides of both rectangles, the least overlapping axis give the penetration
+    const Float2d diff_a2b = core_b.center - core_a.center;
+    const Float2d axes[4] = {core_a.axis, core_a.get_perpendicular(), core_b.axis, core_b.get_perpendicular()};
+    bool is_separated = false;
+    float best_separation = -std::numeric_limits<float>::max();
+    for( const Float2d& axis : axes )
+    {
+        const float radius_a = (core_a.half_length * std::abs(Float2d::dot_product(core_a.axis, axis))) + (core_a.half_width * std::abs(Float2d::dot_product(core_a.get_perpendicular(), axis)));
+        const float radius_b = (core_b.half_length * std::abs(Float2d::dot_product(core_b.axis, axis))) + (core_b.half_width * std::abs(Float2d::dot_product(core_b.get_perpendicular(), axis)));
+        const float projection = Float2d::dot_product(diff_a2b, axis);
+        const float separation = std::abs(projection) - radius_a - radius_b;
+        if( separation > 0.0 )
+        {
+            is_separated = true;
+            break;
+        }
+        if( separation > best_separation )
+        {
+            best_separation = separation;
+            normal_a2b = projection < 0.0 ? -axis : axis;
+        }
+    }
+    if( !is_separated ) return best_separation;
+
+    // Separated convex cores are closest at a vertex of one of them
+    float best_distance = std::numeric_limits<float>::max();
+    Float2d normal;
+    for( size_t i = 0; i < 4; i++ )
+    {
+        const float distance_a = core_b.get_point_distance(core_a.get_vertex(i), normal);
+        if( distance_a < best_distance )
+        {
+            best_distance = distance_a;
+            normal_a2b = -normal;
+        }
+        const float distance_b = core_a.get_point_distance(core_b.get_vertex(i), normal);
+        if( distance_b < best_distance )
+        {
+            best_distance = distance_b;
+            normal_a2b = normal;
+        }
+    }
+    return best_distance;
+}
+
+bool DotShapeCore::raycast(const Float2d& start, const Float2d& direction, const float radius, float& fraction, Float2d& normal) const
+{
+    const float start_distance = get_point_distance(start, normal);
+    if( start_distance < radius )
+    {
+        fraction = 0.0;
+        return true;
+    }
+
+    // Ray in the frame of the core, the grown core is 2 crossed rectangles and 4 corner circles
+    const Float2d perpendicular = get_perpendicular();
+    const Float2d diff = start - center;
+    const Float2d local_start(Float2d::dot_product(diff, axis), Float2d::dot_product(diff, perpendicular));
+    const Float2d local_direction(Float2d::dot_product(direction, axis), Float2d::dot_product(direction, perpendicular));
+
+    bool has_hit = false;
+    float best_fraction = 1.0;
+    Float2d best_local_normal;
+
+    const float half_extents[2][2] = {{half_length + radius, half_width}, {half_length, half_width + radius}};
+    for( const float (&half_extent)[2] : half_extents )
+    {
+        // Entry in the slabs, the start is outside so the entry is on the side of the last slab entered
+        float t_min = 0.0;
+        float t_max = best_fraction;
+        Float2d entry_normal;
+        bool is_valid = true;
+        for( size_t k = 0; k < 2 && is_valid; k++ )
+        {
+            const float start_k = k == 0 ? local_start.x() : local_start.y();
+            const float direction_k = k == 0 ? local_direction.x() : local_direction.y();
+            if( direction_k == 0.0 )
+            {
+                is_valid = std::abs(start_k) <= half_extent[k];
+                continue;
+            }
+            const float t_0 = (-half_extent[k] - start_k) / direction_k;
+            const float t_1 = (half_extent[k] - start_k) / direction_k;
+            const float t_enter = std::min(t_0, t_1);
+            if( t_enter > t_min )
+            {
+                t_min = t_enter;
+                const float side = direction_k > 0.0 ? -1.0f : 1.0f;
+                entry_normal = k == 0 ? Float2d(side, 0.0) : Float2d(0.0, side);
+            }
+            t_max = std::min(t_max, std::max(t_0, t_1));
+            is_valid = t_min <= t_max;
+        }
+        if( is_valid && t_min < best_fraction )
+        {
+            has_hit = true;
+            best_fraction = t_min;
+            best_local_normal = entry_normal;
+        }
+    }
+
+    const float direction_norm2 = local_direction.norm2();
+    for( size_t i = 0; i < 4 && radius > 0.0 && direction_norm2 > 0.0; i++ )
+    {
+        const Float2d corner((i & 1) ? half_length : -half_length, (i & 2) ? half_width : -half_width);
+        const Float2d corner_to_start = local_start - corner;
+        const float b = Float2d::dot_product(corner_to_start, local_direction);
+        const float discriminant = (b * b) - (direction_norm2 * (corner_to_start.norm2() - (radius * radius)));
+        if( b >= 0.0 || discriminant < 0.0 ) continue;
+        const float t = (-b - std::sqrt(discriminant)) / direction_norm2;
+        if( t < 0.0 || t >= best_fraction ) continue;
+        has_hit = true;
+        best_fraction = t;
+        best_local_normal = (corner_to_start + (local_direction * t)) / radius;
+    }
+
+    if( !has_hit ) return false;
+    fraction = best_fraction;
+    normal = (axis * best_local_normal.x()) + (perpendicular * best_local_normal.y());
+    return true;
+}
@@ -0,0 +1,46 @@
+#include <atomic>
+#include <cstdint>
+
+#pragma once
+
+// Single writer / single reader triple buffer, both sides are wait free
+// The writer fill its back buffer then publish it, the reader take the last published buffer
+template<typename T>
+class DotTripleBuffer
+{
+    private:
+    static constexpr uint8_t INDEX_MASK = 0b011;
+    static constexpr uint8_t FRESH_BIT = 0b100;
+
+    T m_buffers[3];
+    uint8_t m_write_index;
+    uint8_t m_read_index;
+    // Index of the buffer between the writer and the reader, with FRESH_BIT if not yet read
+    std::atomic<uint8_t> m_middle_index;
+
+    public:
+    DotTripleBuffer():
+    m_write_index(0),
+    m_read_index(1),
+    m_middle_index(2)
+    {}
+
+    DotTripleBuffer(const DotTripleBuffer&) = delete;
+
+    // Writer side
+    T& get_write_buffer() { return m_buffers[m_write_index]; }
+    void publish() { m_write_index = m_middle_index.exchange(m_write_index | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+    // Reader side, return the last published buffer, it stays valid until the next call
+    const T& read()
+    {
+        if( m_middle_index.load(std::memory_order_relaxed) & FRESH_BIT )
+        {
+            m_read_index = m_middle_index.exchange(m_read_index, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return m_buffers[m_read_index];
+    }
+
+    // Reader side, true if a buffer was published since the last read
+    bool has_new_buffer() const { return m_middle_index.load(std::memory_order_relaxed) & FRESH_BIT; }
+};